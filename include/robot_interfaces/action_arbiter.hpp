@@ -0,0 +1,612 @@
+/**
+ * @file
+ * @brief Arbitration between actions of several clients.
+ * @copyright 2020, Max Planck Gesellschaft. All rights reserved.
+ * @license BSD 3-clause
+ */
+#pragma once
+
+#include <signal.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "control_block.hpp"
+#include "seqlock_slot.hpp"
+
+namespace robot_interfaces
+{
+namespace internal
+{
+//! @brief Header of the memory of an ActionArbiter.
+struct ActionArbiterHeader
+{
+    uint64_t max_clients;
+    uint64_t slot_size;
+    //! @brief Total number of submitted actions of all clients.
+    std::atomic<uint64_t> num_submissions;
+};
+
+//! @brief Registration of a client of an ActionArbiter.
+struct ActionClientInfo
+{
+    //! @brief Whether the slot is considered by ActionArbiter::select().
+    std::atomic<uint32_t> is_registered;
+    std::atomic<int32_t> priority;
+    //! @brief Number of actions submitted in this slot (by any client).
+    std::atomic<uint64_t> num_submissions;
+    /**
+     * @brief ID of the process of the client that owns the slot (0 if the
+     *     slot is free).
+     *
+     * Slots are claimed by setting this with compare-and-swap.
+     */
+    std::atomic<int64_t> process_id;
+
+    ActionClientInfo()
+        : is_registered(0), priority(0), num_submissions(0), process_id(0)
+    {
+    }
+};
+
+//! @brief Check if the process with the given ID exists.
+inline bool is_process_alive(const int64_t process_id)
+{
+    // signal 0 only checks if the process exists
+    return ::kill(static_cast<pid_t>(process_id), 0) == 0 || errno == EPERM;
+}
+}  // namespace internal
+
+/**
+ * @brief Get the shared memory ID of the ActionArbiter of a
+ *     MultiProcessRobotData.
+ *
+ * @param shared_memory_id_prefix  Prefix passed to MultiProcessRobotData.
+ */
+inline std::string get_action_arbiter_shared_memory_id(
+    const std::string &shared_memory_id_prefix)
+{
+    return shared_memory_id_prefix + "_arbiter";
+}
+
+/**
+ * @brief Selects the action of the backend among the actions of several
+ *     clients.
+ *
+ * Allows several controllers (e.g. a learned policy and a safety supervisor)
+ * to command the robot at the same time without coordinating with each
+ * other.  Each client (see ActionClient) has its own slot in which it submits
+ * its current action.  The slots are protected by sequence numbers (see
+ * internal::SeqlockSlotHeader), so clients never wait for each other or for
+ * the backend.
+ *
+ * Whenever the backend needs an action that has not been appended to the
+ * desired actions by a RobotFrontend, it asks the arbiter, which selects the
+ * valid action of the client with the highest priority.  Alternatively, a
+ * merge function can be set that computes the action from the actions of all
+ * clients.  The selected action is appended to the desired actions, so it is
+ * logged like any other action.
+ *
+ * The submitted action of a client stays valid until it is replaced,
+ * withdrawn or expires.  In real-time mode, the backend uses the currently
+ * valid actions at every step, i.e. the action is held until the client
+ * submits a new one.  In non-real-time mode, the backend only makes a step
+ * when a client submitted a new action.
+ *
+ * Do not mix clients and frontends appending actions directly, the time
+ * index of actions appended by a frontend might be taken by an action of the
+ * arbiter.
+ *
+ * For use in multiple processes, the arbiter is placed in shared memory (see
+ * the constructors).
+ *
+ * @tparam Action
+ */
+template <typename Action>
+class ActionArbiter
+{
+public:
+    typedef uint32_t ClientId;
+
+    //! @brief Valid action of a client, passed to the MergeFunction.
+    struct Candidate
+    {
+        ClientId client_id;
+        int32_t priority;
+        Action action;
+    };
+
+    /**
+     * @brief Function that computes the action from the candidates.
+     *
+     * Gets the valid actions of all clients, sorted by descending priority
+     * (there is at least one).
+     */
+    typedef std::function<Action(const std::vector<Candidate> &candidates)>
+        MergeFunction;
+
+    /**
+     * @brief Create an arbiter for use within a single process.
+     *
+     * @param max_clients  Maximum number of clients.
+     * @param slot_size  Maximum size of a serialized action in bytes.  If
+     *     zero, a size based on a default-constructed Action is chosen (see
+     *     internal::get_default_slot_size()).
+     */
+    ActionArbiter(const size_t max_clients = 8, const size_t slot_size = 0)
+    {
+        const size_t size = get_slot_size(slot_size);
+        auto memory = std::make_shared<std::vector<uint64_t>>(
+            (get_memory_size(max_clients, size) + sizeof(uint64_t) - 1) /
+            sizeof(uint64_t));
+        memory_owner_ = memory;
+        initialize(reinterpret_cast<char *>(memory->data()), max_clients, size);
+    }
+
+    /**
+     * @brief Create an arbiter in shared memory.
+     *
+     * To be used by the process of the backend.  An existing arbiter with the
+     * same ID is replaced.
+     *
+     * @param shared_memory_id  ID of the shared memory.
+     * @param max_clients  Maximum number of clients.
+     * @param slot_size  See ActionArbiter(size_t, size_t).
+     */
+    ActionArbiter(const std::string &shared_memory_id,
+                  const size_t max_clients,
+                  const size_t slot_size = 0)
+    {
+        namespace bip = boost::interprocess;
+
+        const size_t size = get_slot_size(slot_size);
+
+        clear_memory(shared_memory_id);
+        auto memory = std::make_shared<internal::SharedMemoryMapping>();
+        memory->object = bip::shared_memory_object(
+            bip::create_only, shared_memory_id.c_str(), bip::read_write);
+        memory->object.truncate(get_memory_size(max_clients, size));
+        memory->region = bip::mapped_region(memory->object, bip::read_write);
+        memory_owner_ = memory;
+
+        initialize(static_cast<char *>(memory->region.get_address()),
+                   max_clients,
+                   size);
+    }
+
+    /**
+     * @brief Open an existing arbiter in shared memory.
+     *
+     * To be used by the processes of the clients.
+     *
+     * @param shared_memory_id  ID of the shared memory.
+     */
+    explicit ActionArbiter(const std::string &shared_memory_id)
+    {
+        namespace bip = boost::interprocess;
+
+        auto memory = std::make_shared<internal::SharedMemoryMapping>();
+        memory->object = bip::shared_memory_object(
+            bip::open_only, shared_memory_id.c_str(), bip::read_write);
+        memory->region = bip::mapped_region(memory->object, bip::read_write);
+        memory_owner_ = memory;
+
+        char *base = static_cast<char *>(memory->region.get_address());
+        header_ = reinterpret_cast<internal::ActionArbiterHeader *>(base);
+        const std::string error_message =
+            "Shared memory " + shared_memory_id +
+            " does not contain an initialised ActionArbiter.";
+        if (memory->region.get_size() < get_header_size() ||
+            header_->max_clients == 0)
+        {
+            throw std::runtime_error(error_message);
+        }
+        // the number of clients is set last, see initialize()
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (memory->region.get_size() <
+            get_memory_size(header_->max_clients, header_->slot_size))
+        {
+            throw std::runtime_error(error_message);
+        }
+        set_pointers(base, header_->max_clients);
+    }
+
+    //! @brief Remove the shared memory of an arbiter.
+    static void clear_memory(const std::string &shared_memory_id)
+    {
+        boost::interprocess::shared_memory_object::remove(
+            shared_memory_id.c_str());
+    }
+
+    /**
+     * @brief Register a client.
+     *
+     * Usually not called directly, see ActionClient.  If all slots are taken,
+     * the slot of a client whose process does not exist anymore (e.g.
+     * because it crashed before unregistering) is reused.
+     *
+     * @param priority  Priority of the client.  Actions of clients with higher
+     *     priority are preferred.
+     * @return ID of the client.
+     * @throws std::runtime_error if the maximum number of clients is reached.
+     */
+    ClientId register_client(const int32_t priority)
+    {
+        const int64_t process_id = ::getpid();
+
+        for (ClientId id = 0; id < header_->max_clients; id++)
+        {
+            int64_t owner = 0;
+            if (clients_[id].process_id.compare_exchange_strong(owner,
+                                                                process_id))
+            {
+                clients_[id].priority = priority;
+                clients_[id].is_registered = 1;
+                return id;
+            }
+        }
+
+        for (ClientId id = 0; id < header_->max_clients; id++)
+        {
+            int64_t owner = clients_[id].process_id;
+            if (owner != 0 && !internal::is_process_alive(owner) &&
+                clients_[id].process_id.compare_exchange_strong(owner,
+                                                                process_id))
+            {
+                std::cerr << "Reuse slot " << id
+                          << " of action client of terminated process "
+                          << owner << "." << std::endl;
+                // The action of the terminated client must not be used
+                // anymore.  If the process was terminated while writing the
+                // slot, the sequence number needs to be made even first.
+                internal::SeqlockSlotHeader *slot = get_slot(id);
+                if (slot->sequence % 2 == 1)
+                {
+                    slot->sequence++;
+                }
+                internal::SeqlockSlotWriter(0).clear(slot);
+                clients_[id].priority = priority;
+                clients_[id].is_registered = 1;
+                return id;
+            }
+        }
+
+        throw std::runtime_error("Maximum number of action clients reached.");
+    }
+
+    //! @brief Unregister a client.  Its slot is then free for new clients.
+    void unregister_client(const ClientId id)
+    {
+        clients_[id].is_registered = 0;
+        // free the slot only after it is no longer considered by select()
+        clients_[id].process_id = 0;
+    }
+
+    //! @brief Change the priority of a client.
+    void set_priority(const ClientId id, const int32_t priority)
+    {
+        clients_[id].priority = priority;
+    }
+
+    //! @brief Get the priority of a client.
+    int32_t get_priority(const ClientId id) const
+    {
+        return clients_[id].priority;
+    }
+
+    /**
+     * @brief Set the function that computes the action from the candidates.
+     *
+     * Only affects the arbitration in this process, so it needs to be set in
+     * the process of the backend.  By default, the action of the candidate
+     * with the highest priority is used.
+     */
+    void set_merge_function(MergeFunction merge_function)
+    {
+        merge_function_ = merge_function;
+    }
+
+    /**
+     * @brief Total number of submitted actions of all clients.
+     *
+     * Can be compared to a previous value to check for new actions without
+     * reading the slots.
+     */
+    uint64_t get_number_of_submissions() const
+    {
+        return header_->num_submissions.load();
+    }
+
+    /**
+     * @brief Select the action among the valid actions of the clients.
+     *
+     * Only to be called by the backend.
+     *
+     * @param action  Set to the selected action.
+     * @param only_if_new  If true, only select an action if a client submitted
+     *     a new action since the last call.
+     *
+     * @return False if no action is selected.
+     */
+    bool select(Action &action, const bool only_if_new)
+    {
+        const double now_s = get_current_time_s();
+
+        candidates_.clear();
+        bool has_new_action = false;
+        for (ClientId id = 0; id < header_->max_clients; id++)
+        {
+            if (!clients_[id].is_registered)
+            {
+                continue;
+            }
+
+            Candidate candidate;
+            int64_t submission;
+            double expiry_time_s;
+            if (!internal::read_seqlock_slot(get_slot(id),
+                                             read_buffer_,
+                                             candidate.action,
+                                             submission,
+                                             &expiry_time_s) ||
+                expiry_time_s < now_s)
+            {
+                continue;
+            }
+
+            candidate.client_id = id;
+            candidate.priority = clients_[id].priority;
+            candidates_.push_back(candidate);
+
+            if (last_selected_submissions_[id] != submission)
+            {
+                has_new_action = true;
+                last_selected_submissions_[id] = submission;
+            }
+        }
+
+        if (candidates_.empty() || (only_if_new && !has_new_action))
+        {
+            return false;
+        }
+
+        std::stable_sort(
+            candidates_.begin(),
+            candidates_.end(),
+            [](const Candidate &a, const Candidate &b) {
+                return a.priority > b.priority;
+            });
+        action = merge_function_ ? merge_function_(candidates_)
+                                 : candidates_.front().action;
+        return true;
+    }
+
+    // used by ActionClient
+    internal::SeqlockSlotHeader *get_slot(const ClientId id) const
+    {
+        return reinterpret_cast<internal::SeqlockSlotHeader *>(
+            slots_ + id * slot_stride_);
+    }
+    internal::ActionClientInfo &get_client_info(const ClientId id)
+    {
+        return clients_[id];
+    }
+    size_t get_slot_size() const
+    {
+        return header_->slot_size;
+    }
+    void count_submission()
+    {
+        header_->num_submissions++;
+    }
+
+    //! @brief Current time on the clock used for expiry times.
+    static double get_current_time_s()
+    {
+        return std::chrono::duration<double>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+private:
+    typedef internal::SeqlockSlotHeader SlotHeader;
+
+    std::shared_ptr<void> memory_owner_;
+    internal::ActionArbiterHeader *header_;
+    internal::ActionClientInfo *clients_;
+    char *slots_;
+    size_t slot_stride_;
+
+    // state of the arbitration in this process
+    MergeFunction merge_function_;
+    std::vector<Candidate> candidates_;
+    std::vector<int64_t> last_selected_submissions_;
+    //! @brief Buffer for reading the slots, so select() does not allocate.
+    std::vector<char> read_buffer_;
+
+    static size_t get_slot_size(const size_t slot_size)
+    {
+        return slot_size > 0 ? slot_size
+                             : internal::get_default_slot_size<Action>();
+    }
+
+    static size_t get_header_size()
+    {
+        return SlotHeader::align(sizeof(internal::ActionArbiterHeader));
+    }
+
+    static size_t get_memory_size(const size_t max_clients,
+                                  const size_t slot_size)
+    {
+        // header, client infos and slots
+        return get_header_size() +
+               SlotHeader::align(max_clients *
+                                 sizeof(internal::ActionClientInfo)) +
+               max_clients * SlotHeader::get_stride(slot_size);
+    }
+
+    void initialize(char *base,
+                    const size_t max_clients,
+                    const size_t slot_size)
+    {
+        if (max_clients == 0)
+        {
+            throw std::invalid_argument(
+                "max_clients must be greater than zero.");
+        }
+
+        header_ = new (base) internal::ActionArbiterHeader();
+        header_->max_clients = 0;
+        header_->slot_size = slot_size;
+        header_->num_submissions = 0;
+
+        set_pointers(base, max_clients);
+
+        for (size_t i = 0; i < max_clients; i++)
+        {
+            new (&clients_[i]) internal::ActionClientInfo();
+            new (get_slot(i)) SlotHeader();
+        }
+
+        // Set the number of clients last, clients opening the arbiter check
+        // it to see if the memory is initialised.
+        std::atomic_thread_fence(std::memory_order_release);
+        header_->max_clients = max_clients;
+    }
+
+    void set_pointers(char *base, const size_t max_clients)
+    {
+        slot_stride_ = SlotHeader::get_stride(header_->slot_size);
+        clients_ = reinterpret_cast<internal::ActionClientInfo *>(
+            base + get_header_size());
+        slots_ = base + get_header_size() +
+                 SlotHeader::align(max_clients *
+                                   sizeof(internal::ActionClientInfo));
+        last_selected_submissions_.assign(max_clients, -1);
+        candidates_.reserve(max_clients);
+        read_buffer_.resize(header_->slot_size);
+    }
+};
+
+/**
+ * @brief Client of an ActionArbiter.
+ *
+ * Registers with the arbiter on construction and unregisters on destruction.
+ * A client must only be used by one thread at a time.
+ *
+ * @tparam Action
+ */
+template <typename Action>
+class ActionClient
+{
+public:
+    /**
+     * @brief Default validity of submitted actions in seconds.
+     *
+     * Finite, so that the action of a client that stops submitting (e.g.
+     * because its process crashed) is not held forever.
+     */
+    static constexpr double default_validity_s = 0.1;
+
+    /**
+     * @param arbiter  The arbiter (e.g. RobotData::action_arbiter).
+     * @param control_block  If set, the backend is woken up through it when
+     *     an action is submitted (e.g. RobotData::control_block).
+     * @param priority  Priority of the client.  Actions of clients with higher
+     *     priority are preferred.
+     */
+    ActionClient(std::shared_ptr<ActionArbiter<Action>> arbiter,
+                 std::shared_ptr<ControlBlock> control_block,
+                 const int32_t priority)
+        : arbiter_(arbiter),
+          control_block_(control_block),
+          id_(arbiter->register_client(priority)),
+          writer_(arbiter->get_slot_size())
+    {
+    }
+
+    ~ActionClient()
+    {
+        withdraw();
+        arbiter_->unregister_client(id_);
+    }
+
+    ActionClient(const ActionClient &) = delete;
+    ActionClient &operator=(const ActionClient &) = delete;
+
+    /**
+     * @brief Submit an action.
+     *
+     * Replaces the previously submitted action of this client.  Never blocks.
+     *
+     * @param action  The action.
+     * @param validity_s  Time after which the action expires, i.e. is not
+     *     used by the arbiter anymore.  This makes sure that the robot does
+     *     not keep executing an outdated action if the client stops, so
+     *     clients that hold an action for longer need to submit it again
+     *     (or explicitly pass a longer validity).
+     *
+     * @throws std::length_error if the serialized action does not fit into
+     *     the slot.
+     */
+    void submit(const Action &action,
+                const double validity_s = default_validity_s)
+    {
+        internal::ActionClientInfo &info = arbiter_->get_client_info(id_);
+        const int64_t submission = info.num_submissions++;
+        const double expiry_time_s =
+            ActionArbiter<Action>::get_current_time_s() + validity_s;
+
+        if (!writer_.write(
+                arbiter_->get_slot(id_), submission, expiry_time_s, action))
+        {
+            throw std::length_error("Action is too large for the slot.");
+        }
+
+        arbiter_->count_submission();
+        if (control_block_)
+        {
+            control_block_->notify();
+        }
+    }
+
+    //! @brief Withdraw the submitted action, so it is not used anymore.
+    void withdraw()
+    {
+        writer_.clear(arbiter_->get_slot(id_));
+    }
+
+    //! @brief Change the priority of the client.
+    void set_priority(const int32_t priority)
+    {
+        arbiter_->set_priority(id_, priority);
+    }
+
+    int32_t get_priority() const
+    {
+        return arbiter_->get_priority(id_);
+    }
+
+private:
+    std::shared_ptr<ActionArbiter<Action>> arbiter_;
+    std::shared_ptr<ControlBlock> control_block_;
+    const typename ActionArbiter<Action>::ClientId id_;
+    internal::SeqlockSlotWriter writer_;
+};
+
+template <typename Action>
+constexpr double ActionClient<Action>::default_validity_s;
+
+}  // namespace robot_interfaces
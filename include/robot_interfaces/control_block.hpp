@@ -0,0 +1,367 @@
+/**
+ * @file
+ * @brief State that is shared between the backend and all frontends.
+ * @copyright 2020, Max Planck Gesellschaft. All rights reserved.
+ * @license BSD 3-clause
+ */
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/interprocess/managed_shared_memory.hpp>
+#include <boost/interprocess/sync/interprocess_condition.hpp>
+#include <boost/interprocess/sync/interprocess_mutex.hpp>
+#include <boost/interprocess/sync/scoped_lock.hpp>
+
+namespace robot_interfaces
+{
+/**
+ * @brief Small block of state shared between backend and frontends.
+ *
+ * In contrast to the time series of RobotData, which store the history of the
+ * data, this contains only a few lock-free values that describe the current
+ * state of the backend.  They can be read with a single atomic load, so
+ * frontends can check them as often as they like without interfering with the
+ * backend.
+ *
+ * Further, it provides a condition variable on which the backend can sleep
+ * until a frontend publishes a new desired action or the backend is asked to
+ * shut down (see wait() and notify()).
+ *
+ * Since all members are address-free atomics or process-shared
+ * synchronisation primitives, the struct can be placed in shared memory (see
+ * create_multi_process_control_block()).
+ */
+struct ControlBlock
+{
+    /**
+     * @brief Number of times a backend has been started on the data.
+     *
+     * Frontends can compare this with a previously read value to detect that
+     * the backend has been restarted.
+     */
+    std::atomic<uint64_t> generation;
+
+    /**
+     * @brief Newest time index of the desired actions.
+     *
+     * Published by the frontends after appending an action.  Only a hint for
+     * waiting with WaitStrategy::SpinThenBlock(), the time series remain the
+     * reference.
+     */
+    std::atomic<int64_t> newest_desired_action;
+
+    /**
+     * @brief Newest time index of the observations.
+     *
+     * Published by the backend after appending an observation.  Only a hint
+     * for waiting with WaitStrategy::SpinThenBlock(), the time series remain
+     * the reference.
+     */
+    std::atomic<int64_t> newest_observation;
+
+    /**
+     * @brief Generation of the backend that reported an error (0 if none).
+     *
+     * Set by the backend after appending a status with error.  Frontends can
+     * compare it with the current generation to check for an error without
+     * reading the status time series.
+     */
+    std::atomic<uint64_t> error_generation;
+
+    /**
+     * @brief Generation of the backend that terminated (0 if none).
+     *
+     * Set by the backend when its loop ends, for whatever reason.  Like
+     * error_generation, it only applies if it matches the current generation.
+     */
+    std::atomic<uint64_t> terminated_generation;
+
+    /**
+     * @brief Number of appends of desired actions that found the buffer full.
+     *
+     * Counted by the frontends, see RobotFrontend::append_desired_action().
+     */
+    std::atomic<uint64_t> num_blocked_appends;
+
+    /**
+     * @brief Sequence number of the step values below.
+     *
+     * The step values are published by the backend at the beginning of each
+     * step, so that frontends can predict when the backend needs the next
+     * action (see RobotFrontend::get_action_deadline()).  The sequence number
+     * is odd while they are updated (see publish_step() and read_step()).
+     */
+    std::atomic<uint64_t> step_sequence;
+
+    //! @brief Index of the step the backend is executing (-1 if none).
+    std::atomic<int64_t> step_timeindex;
+
+    //! @brief Start time of the step in ns of std::chrono::steady_clock.
+    std::atomic<int64_t> step_start_time_ns;
+
+    //! @brief Moving average of the step duration in ns (0 if unknown).
+    std::atomic<int64_t> step_period_ns;
+
+    //! @brief Number of times the action of the step is a repetition.
+    std::atomic<uint32_t> action_repetitions;
+
+    /**
+     * @brief Maximum number of action repetitions of the backend.
+     *
+     * -1 if the backend does not run in real-time mode, i.e. it waits for
+     * actions instead of repeating them.
+     */
+    std::atomic<int64_t> max_action_repetitions;
+
+    ControlBlock()
+        : generation(0),
+          terminated_generation(0),
+          num_blocked_appends(0),
+          step_sequence(0),
+          num_waiters_(0)
+    {
+        reset();
+    }
+
+    /**
+     * @brief Reset all values that refer to the content of the time series.
+     *
+     * To be called when the time series are cleared.  The generation is kept.
+     */
+    void reset()
+    {
+        newest_desired_action = -1;
+        newest_observation = -1;
+        error_generation = 0;
+        step_timeindex = -1;
+        step_start_time_ns = 0;
+        step_period_ns = 0;
+        action_repetitions = 0;
+        max_action_repetitions = -1;
+    }
+
+    /**
+     * @brief Publish the step values.  Only to be called by the backend.
+     */
+    void publish_step(const int64_t timeindex,
+                      const int64_t start_time_ns,
+                      const int64_t period_ns,
+                      const uint32_t repetitions,
+                      const int64_t max_repetitions)
+    {
+        const uint64_t sequence = step_sequence.load(std::memory_order_relaxed);
+        step_sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        step_timeindex.store(timeindex, std::memory_order_relaxed);
+        step_start_time_ns.store(start_time_ns, std::memory_order_relaxed);
+        step_period_ns.store(period_ns, std::memory_order_relaxed);
+        action_repetitions.store(repetitions, std::memory_order_relaxed);
+        max_action_repetitions.store(max_repetitions,
+                                     std::memory_order_relaxed);
+
+        step_sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    /**
+     * @brief Read a consistent snapshot of the step values.
+     *
+     * Retries if the backend updates them concurrently, which is very rare
+     * as this happens only once per step.
+     */
+    void read_step(int64_t &timeindex,
+                   int64_t &start_time_ns,
+                   int64_t &period_ns,
+                   uint32_t &repetitions,
+                   int64_t &max_repetitions) const
+    {
+        while (true)
+        {
+            const uint64_t sequence =
+                step_sequence.load(std::memory_order_acquire);
+            timeindex = step_timeindex.load(std::memory_order_relaxed);
+            start_time_ns = step_start_time_ns.load(std::memory_order_relaxed);
+            period_ns = step_period_ns.load(std::memory_order_relaxed);
+            repetitions = action_repetitions.load(std::memory_order_relaxed);
+            max_repetitions =
+                max_action_repetitions.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (sequence % 2 == 0 &&
+                step_sequence.load(std::memory_order_relaxed) == sequence)
+            {
+                return;
+            }
+        }
+    }
+
+    /**
+     * @brief Wake up all threads that are blocked in wait().
+     *
+     * To be called after changing a value the waiting threads may depend on.
+     * Cheap if nobody is waiting, so it can be called on every change.
+     */
+    void notify()
+    {
+        if (num_waiters_.load() > 0)
+        {
+            // Acquire the mutex once, so that a waiter that already checked
+            // its condition is guaranteed to be waiting on the condition
+            // variable before it is notified.
+            {
+                Lock lock(mutex_);
+            }
+            condition_.notify_all();
+        }
+    }
+
+    /**
+     * @brief Block until a condition is true, woken up by notify().
+     *
+     * The condition is checked whenever notify() is called by any process.
+     * It must not depend on values that are changed without calling notify()
+     * afterwards, these are only noticed when the timeout expires.
+     *
+     * @param is_done  Function that returns true if the condition is met.  It
+     *     is called while holding the internal mutex, so it should be cheap.
+     * @param max_duration_s  Maximum time to wait.  Set to infinity to wait
+     *     without timeout.
+     *
+     * @return Result of is_done() when returning.
+     */
+    template <typename Predicate>
+    bool wait(Predicate is_done, const double max_duration_s)
+    {
+        if (is_done())
+        {
+            return true;
+        }
+
+        Lock lock(mutex_);
+        // must be increased before the condition is checked again, see
+        // notify()
+        num_waiters_++;
+
+        bool result;
+        if (std::isinf(max_duration_s))
+        {
+            condition_.wait(lock, is_done);
+            result = true;
+        }
+        else
+        {
+            const boost::posix_time::ptime deadline =
+                boost::posix_time::microsec_clock::universal_time() +
+                boost::posix_time::microseconds(
+                    static_cast<int64_t>(max_duration_s * 1e6));
+            result = condition_.timed_wait(lock, deadline, is_done);
+        }
+
+        num_waiters_--;
+        return result;
+    }
+
+private:
+    typedef boost::interprocess::scoped_lock<
+        boost::interprocess::interprocess_mutex>
+        Lock;
+
+    boost::interprocess::interprocess_mutex mutex_;
+    boost::interprocess::interprocess_condition condition_;
+    std::atomic<uint32_t> num_waiters_;
+};
+
+/**
+ * @brief Publish a new time index in one of the ControlBlock values.
+ *
+ * The value is only ever increased, so concurrent writers cannot make it go
+ * backwards.
+ */
+inline void publish_timeindex(std::atomic<int64_t> &newest_timeindex,
+                              const int64_t timeindex)
+{
+    int64_t current = newest_timeindex.load();
+    while (current < timeindex &&
+           !newest_timeindex.compare_exchange_weak(current, timeindex))
+    {
+    }
+}
+
+//! @brief Create a ControlBlock for use within a single process.
+inline std::shared_ptr<ControlBlock> create_single_process_control_block()
+{
+    return std::make_shared<ControlBlock>();
+}
+
+namespace internal
+{
+/**
+ * @brief Shared memory segment holding a ControlBlock.
+ *
+ * Keeps the segment mapped for as long as the ControlBlock is in use.
+ */
+class ControlBlockSegment
+{
+public:
+    ControlBlockSegment(const std::string &shared_memory_id)
+        : segment_(boost::interprocess::open_or_create,
+                   shared_memory_id.c_str(),
+                   SEGMENT_SIZE)
+    {
+    }
+
+    ControlBlock *get_control_block()
+    {
+        return segment_.find_or_construct<ControlBlock>("control_block")();
+    }
+
+private:
+    static constexpr size_t SEGMENT_SIZE = 65536;
+
+    boost::interprocess::managed_shared_memory segment_;
+};
+}  // namespace internal
+
+/**
+ * @brief Create or attach to a ControlBlock in shared memory.
+ *
+ * If the shared memory segment does not exist yet, it is created and the
+ * control block is initialised.  Otherwise the existing one is used, i.e. its
+ * values are preserved.  The segment is not removed automatically, use
+ * clear_control_block() for this.
+ *
+ * @param shared_memory_id  ID of the shared memory segment.
+ */
+inline std::shared_ptr<ControlBlock> create_multi_process_control_block(
+    const std::string &shared_memory_id)
+{
+    auto segment =
+        std::make_shared<internal::ControlBlockSegment>(shared_memory_id);
+
+    // aliasing constructor: the segment stays mapped as long as the control
+    // block is referenced
+    return std::shared_ptr<ControlBlock>(segment,
+                                         segment->get_control_block());
+}
+
+/**
+ * @brief Remove the shared memory of a ControlBlock.
+ *
+ * Processes that still have the control block mapped can continue to use it,
+ * new ones will create a new control block.
+ *
+ * @param shared_memory_id  ID of the shared memory segment.
+ */
+inline void clear_control_block(const std::string &shared_memory_id)
+{
+    boost::interprocess::shared_memory_object::remove(
+        shared_memory_id.c_str());
+}
+
+}  // namespace robot_interfaces
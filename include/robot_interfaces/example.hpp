@@ -32,6 +32,12 @@ public:
             std::cout << "\n";
         }
     }
+
+    template <class Archive>
+    void serialize(Archive &ar)
+    {
+        ar(values);
+    }
 };
 
 /**
@@ -52,6 +58,12 @@ public:
             std::cout << "\n";
         }
     }
+
+    template <class Archive>
+    void serialize(Archive &ar)
+    {
+        ar(values);
+    }
 };
 
 /**
@@ -8,6 +8,12 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
 namespace robot_interfaces
 {
 /*
@@ -29,6 +35,87 @@ public:
      * @brief Return the data in the fields of the structure.
      */
     virtual std::vector<std::vector<double>> get_data() = 0;
+
+    /*
+     * @brief Return the number of values of all fields together.
+     *
+     * The default implementation counts the values returned by get_data().
+     * Override it if the number is known without allocating memory.
+     */
+    virtual size_t get_number_of_values()
+    {
+        size_t count = 0;
+        for (const std::vector<double> &field : get_data())
+        {
+            count += field.size();
+        }
+        return count;
+    }
+
+    /*
+     * @brief Write the values of all fields to a flat buffer.
+     *
+     * The values are written in the same order as returned by get_data().  In
+     * contrast to get_data(), this can be implemented without allocating
+     * memory (see LoggableDataWriter), which is what the RobotLogger uses for
+     * each logged element.  The default implementation is based on
+     * get_data(), so types should override it.
+     *
+     * @param data  The buffer.
+     * @param size  Size of the buffer.
+     * @return Number of values written.
+     * @throws std::length_error if the buffer is too small.
+     */
+    virtual size_t write_data(double *data, size_t size)
+    {
+        LoggableDataWriter writer(data, size);
+        for (const std::vector<double> &field : get_data())
+        {
+            writer.write(field.data(), field.size());
+        }
+        return writer.get_count();
+    }
+
+protected:
+    /*
+     * @brief Helper for implementing write_data().
+     */
+    class LoggableDataWriter
+    {
+    public:
+        LoggableDataWriter(double *data, size_t size)
+            : data_(data), size_(size), count_(0)
+        {
+        }
+
+        //! @brief Append count values to the buffer.
+        void write(const double *values, size_t count)
+        {
+            if (count_ + count > size_)
+            {
+                throw std::length_error("Buffer for logged values too small.");
+            }
+            std::copy(values, values + count, data_ + count_);
+            count_ += count;
+        }
+
+        //! @brief Append a single value to the buffer.
+        void write(double value)
+        {
+            write(&value, 1);
+        }
+
+        //! @brief Number of values written so far.
+        size_t get_count() const
+        {
+            return count_;
+        }
+
+    private:
+        double *data_;
+        size_t size_;
+        size_t count_;
+    };
 };
 
 }  // namespace robot_interfaces
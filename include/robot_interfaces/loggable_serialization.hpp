@@ -0,0 +1,269 @@
+/**
+ * @file
+ * @brief Implementation of Loggable based on the serialize() method of a type.
+ * @copyright 2020, Max Planck Gesellschaft. All rights reserved.
+ * @license BSD 3-clause
+ */
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <cereal/cereal.hpp>
+
+#include <robot_interfaces/loggable.hpp>
+
+namespace robot_interfaces
+{
+namespace internal
+{
+/**
+ * @brief Archive that passes the numeric values of a serialize() method to a
+ * visitor.
+ *
+ * The archive is compatible to the serialize() methods written for cereal,
+ * i.e. it can be called with any number of values.  They are handled as
+ * follows:
+ *
+ * - cereal::NameValuePair (i.e. CEREAL_NVP): The name is used for the
+ *   field(s) of the value.
+ * - Arithmetic types and enums: A field with one value.
+ * - Types with data() and size() (e.g. fixed-size Eigen vectors or
+ *   std::array): A field with size() values.
+ * - Types with a serialize() method: The fields of the nested type are
+ *   inserted in place, their names prefixed with the name of the nested
+ *   value (e.g. "timing_overrun"), so that they cannot clash with fields of
+ *   the outer type.
+ * - std::string: Ignored as only numeric values can be logged.
+ *
+ * The visitor needs the methods `begin_field(const char *name)`,
+ * `value(double)`, `begin_nested(const char *name)` and `end_nested()`.
+ * Field names passed to begin_field() are not prefixed, visitors that need
+ * the full names have to keep track of the nesting themselves.
+ *
+ * @tparam Visitor  Type of the visitor.
+ */
+template <typename Visitor>
+class LoggableArchive
+{
+public:
+    LoggableArchive(Visitor &visitor) : visitor_(visitor), name_("value")
+    {
+    }
+
+    template <typename... Types>
+    void operator()(Types &&... values)
+    {
+        int dummy[] = {0, (process(values), 0)...};
+        (void)dummy;
+    }
+
+private:
+    Visitor &visitor_;
+    //! @brief Name of the value that is currently processed.
+    const char *name_;
+
+    template <typename T>
+    void process(const cereal::NameValuePair<T> &named_value)
+    {
+        const char *outer_name = name_;
+        name_ = named_value.name;
+        process(named_value.value);
+        name_ = outer_name;
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_arithmetic<T>::value ||
+                            std::is_enum<T>::value>::type
+    process(const T &value)
+    {
+        visitor_.begin_field(name_);
+        visitor_.value(static_cast<double>(value));
+    }
+
+    template <typename T>
+    auto process(const T &values)
+        -> decltype(static_cast<double>(*values.data()), values.size(), void())
+    {
+        visitor_.begin_field(name_);
+        for (size_t i = 0; i < static_cast<size_t>(values.size()); i++)
+        {
+            visitor_.value(static_cast<double>(values.data()[i]));
+        }
+    }
+
+    template <typename T>
+    auto process(T &value) -> decltype(value.serialize(*this), void())
+    {
+        visitor_.begin_nested(name_);
+        value.serialize(*this);
+        visitor_.end_nested();
+    }
+
+    void process(const std::string &)
+    {
+    }
+};
+}  // namespace internal
+
+/**
+ * @brief Loggable that derives the logged fields from serialize().
+ *
+ * Names and values of the fields are determined by running the serialize()
+ * method of the type with internal::LoggableArchive, so they always match
+ * what is serialized.  Values have to be wrapped with CEREAL_NVP to get a
+ * name.  Only fixed-size fields are supported, as the number of values has
+ * to be the same for all elements of a log.
+ *
+ * Counting and writing the values does not allocate memory, and for types
+ * with fixed-size members the loops are resolved by the compiler.
+ *
+ * Usage:
+ *
+ *     struct MyObservation : public SerializedLoggable<MyObservation>
+ *     {
+ *         Eigen::Vector3d position;
+ *
+ *         template <class Archive>
+ *         void serialize(Archive &archive)
+ *         {
+ *             archive(CEREAL_NVP(position));
+ *         }
+ *     };
+ *
+ * @tparam Derived  The type that derives from this class (needs a
+ *     serialize() method).
+ */
+template <typename Derived>
+class SerializedLoggable : public Loggable
+{
+public:
+    std::vector<std::string> get_name() override
+    {
+        NameVisitor visitor;
+        visit(visitor);
+        return visitor.names;
+    }
+
+    std::vector<std::vector<double>> get_data() override
+    {
+        DataVisitor visitor;
+        visit(visitor);
+        return visitor.data;
+    }
+
+    size_t get_number_of_values() override
+    {
+        CountVisitor visitor;
+        visit(visitor);
+        return visitor.count;
+    }
+
+    size_t write_data(double *data, size_t size) override
+    {
+        WriteVisitor visitor(data, size);
+        visit(visitor);
+        return visitor.writer.get_count();
+    }
+
+private:
+    struct NameVisitor
+    {
+        std::vector<std::string> names;
+        //! @brief Prefixes of the enclosing nested values.
+        std::vector<std::string> prefixes;
+
+        void begin_field(const char *name)
+        {
+            names.push_back(prefixes.empty() ? std::string(name)
+                                             : prefixes.back() + name);
+        }
+        void value(double)
+        {
+        }
+        void begin_nested(const char *name)
+        {
+            prefixes.push_back(
+                (prefixes.empty() ? std::string() : prefixes.back()) + name +
+                "_");
+        }
+        void end_nested()
+        {
+            prefixes.pop_back();
+        }
+    };
+
+    struct DataVisitor
+    {
+        std::vector<std::vector<double>> data;
+
+        void begin_field(const char *)
+        {
+            data.emplace_back();
+        }
+        void value(double v)
+        {
+            data.back().push_back(v);
+        }
+        void begin_nested(const char *)
+        {
+        }
+        void end_nested()
+        {
+        }
+    };
+
+    struct CountVisitor
+    {
+        size_t count = 0;
+
+        void begin_field(const char *)
+        {
+        }
+        void value(double)
+        {
+            count++;
+        }
+        void begin_nested(const char *)
+        {
+        }
+        void end_nested()
+        {
+        }
+    };
+
+    struct WriteVisitor
+    {
+        LoggableDataWriter writer;
+
+        WriteVisitor(double *data, size_t size) : writer(data, size)
+        {
+        }
+
+        void begin_field(const char *)
+        {
+        }
+        void value(double v)
+        {
+            writer.write(v);
+        }
+        void begin_nested(const char *)
+        {
+        }
+        void end_nested()
+        {
+        }
+    };
+
+    template <typename Visitor>
+    void visit(Visitor &visitor)
+    {
+        internal::LoggableArchive<Visitor> archive(visitor);
+        static_cast<Derived *>(this)->serialize(archive);
+    }
+};
+
+}  // namespace robot_interfaces
@@ -8,17 +8,22 @@
 
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <cmath>
+#include <cstdint>
 #include <iostream>
+#include <stdexcept>
+#include <thread>
 
 #include <real_time_tools/process_manager.hpp>
-#include <real_time_tools/thread.hpp>
 #include <real_time_tools/threadsafe/threadsafe_object.hpp>
 #include <real_time_tools/timer.hpp>
-#include <time_series/time_series.hpp>
 
 #include <robot_interfaces/robot_driver.hpp>
+#include <robot_interfaces/timing_statistics.hpp>
+#include <robot_interfaces/watchdog_service.hpp>
 
 namespace robot_interfaces
 {
@@ -26,7 +31,7 @@ namespace robot_interfaces
  * @brief Wrapper for RobotDriver that monitors timing.
  *
  * Takes a RobotDriver instance as input and forwards all method calls to it.  A
- * background loop monitors timing of actions to ensure the following
+ * WatchdogService monitors timing of actions to ensure the following
  * constraints:
  *
  *   1. The execution of an action does not take longer than
@@ -38,6 +43,21 @@ namespace robot_interfaces
  * If these timing constraints are not satisfied, the robot will be shutdown,
  * and no more actions from the outside will be accepted.
  *
+ * Optionally, the robot is only shut down if a hard threshold above these time
+ * budgets is exceeded.  Durations that come close to or exceed the budget
+ * without reaching the hard threshold are counted (see TimingThresholds and
+ * get_timing_statistics()).  This way degrading latency can be observed before
+ * it leads to a shutdown.
+ *
+ * `apply_action()` only records the time of the start and end of the action in
+ * a lock-free atomic.  The watchdog checks the deadline that follows from the
+ * last recorded event (see check_timing()).  By default, all monitored drivers
+ * of a process share a single watchdog thread.
+ *
+ * Further, statistics about the durations of actions and the gaps between them
+ * are recorded, see get_timing_statistics().  They can be used to tune the
+ * timeouts.
+ *
  * This wrapper also makes sure that the `shutdown()` method of the given
  * RobotDriver is called when wrapper is destroyed, so the robot should always
  * be left in a safe state.
@@ -53,32 +73,57 @@ public:
     typedef std::shared_ptr<Driver> RobotDriverPtr;
 
     /**
-     * @brief Starts a thread for monitoring timing of action execution.
+     * @brief Registers the driver with a watchdog for monitoring timing of
+     *     action execution.
      *
      * @param robot_driver  The actual robot driver instance.
      * @param max_action_duration_s  Maximum time allowed for an action to be
      *     executed.
      * @param max_inter_action_duration_s  Maximum time allowed between end of
      *     the previous action and receival of the next one.
+     * @param watchdog  The watchdog service that monitors the timing.  If not
+     *     set, the default service of the process is used (see
+     *     WatchdogService::get_default()).
+     * @param thresholds  Warning and hard threshold relative to the maximum
+     *     durations.  By default, the robot is shut down when exceeding the
+     *     maximum durations.
      */
     MonitoredRobotDriver(RobotDriverPtr robot_driver,
                          const double max_action_duration_s,
-                         const double max_inter_action_duration_s)
+                         const double max_inter_action_duration_s,
+                         std::shared_ptr<WatchdogService> watchdog = nullptr,
+                         const TimingThresholds &thresholds = TimingThresholds())
         : robot_driver_(robot_driver),
           max_action_duration_s_(max_action_duration_s),
           max_inter_action_duration_s_(max_inter_action_duration_s),
+          max_action_duration_(to_clock_duration(thresholds.hard_fraction *
+                                                 max_action_duration_s)),
+          max_inter_action_duration_(to_clock_duration(
+              thresholds.hard_fraction * max_inter_action_duration_s)),
           is_shutdown_(false),
-          action_start_logger_(1000),
-          action_end_logger_(1000)
+          last_event_(NO_EVENT),
+          last_action_end_time_ns_(NO_EVENT),
+          timing_recorder_(max_action_duration_s,
+                           max_inter_action_duration_s,
+                           thresholds)
     {
-        thread_ = std::make_shared<real_time_tools::RealTimeThread>();
+        if (thresholds.hard_fraction < 1.0)
+        {
+            throw std::invalid_argument(
+                "Hard threshold must not be below the time budget.");
+        }
 
-        // if both timeouts are infinite, there is no need to start the loop at
-        // all
+        // if both timeouts are infinite, there is no need to monitor at all
         if (std::isfinite(max_action_duration_s_) &&
             std::isfinite(max_inter_action_duration_s_))
         {
-            thread_->create_realtime_thread(&MonitoredRobotDriver::loop, this);
+            watchdog_ = watchdog ? watchdog : WatchdogService::get_default();
+            watchdog_client_id_ = watchdog_->add(
+                [this](const WatchdogService::Clock::time_point &now,
+                       WatchdogService::Clock::time_point &next_check) {
+                    return check_timing(now, next_check);
+                },
+                WatchdogService::Clock::now());
         }
         else
         {
@@ -92,12 +137,19 @@ public:
     }
 
     /**
-     * @brief Shuts down the robot and stops the monitoring thread.
+     * @brief Stops monitoring and shuts down the robot.
      */
     ~MonitoredRobotDriver()
     {
+        if (watchdog_)
+        {
+            watchdog_->remove(watchdog_client_id_);
+        }
+        if (shutdown_thread_.joinable())
+        {
+            shutdown_thread_.join();
+        }
         shutdown();
-        thread_->join();
     }
 
     /**
@@ -119,13 +171,34 @@ public:
             // in case of shutdown.  Shouldn't it rather be s.th. like Zero()?
             return desired_action;
         }
-        action_start_logger_.append(true);
+        const int64_t start_time_ns = record_event(true);
         typename Driver::Action applied_action =
             robot_driver_->apply_action(desired_action);
-        action_end_logger_.append(true);
+        const int64_t end_time_ns = record_event(false);
+
+        if (last_action_end_time_ns_ != NO_EVENT)
+        {
+            timing_recorder_.add_inter_action_duration(
+                (start_time_ns - last_action_end_time_ns_) * 1e-9);
+        }
+        timing_recorder_.add_action_duration((end_time_ns - start_time_ns) *
+                                             1e-9);
+        last_action_end_time_ns_ = end_time_ns;
+
         return applied_action;
     }
 
+    /**
+     * @brief Get statistics about the timing of the actions so far.
+     *
+     * Can be called from any thread at any time.  The values are updated
+     * independently, so they may differ by one action.
+     */
+    ActionTimingStatistics get_timing_statistics() const
+    {
+        return timing_recorder_.get();
+    }
+
     virtual void initialize()
     {
         robot_driver_->initialize();
@@ -156,9 +229,8 @@ public:
      */
     virtual void shutdown() final
     {
-        if (!is_shutdown_)
+        if (!is_shutdown_.exchange(true))
         {
-            is_shutdown_ = true;
             robot_driver_->shutdown();
         }
     }
@@ -171,60 +243,130 @@ private:
     //! \brief Max. idle time between actions.
     double max_inter_action_duration_s_;
 
+    typedef WatchdogService::Clock Clock;
+
+    //! \brief Hard thresholds converted to the clock of the watchdog.
+    Clock::duration max_action_duration_;
+    Clock::duration max_inter_action_duration_;
+
     //! \brief Whether shutdown was initiated.
     std::atomic<bool> is_shutdown_;
 
-    time_series::TimeSeries<bool> action_start_logger_;
-    time_series::TimeSeries<bool> action_end_logger_;
+    //! \brief Value of last_event_ before the first action is started.
+    static constexpr int64_t NO_EVENT = -1;
+
+    /**
+     * \brief Last start or end of an action.
+     *
+     * Encodes the time of the event in nanoseconds since the epoch of Clock
+     * and, in the lowest bit, whether it is the start of an action.  This way
+     * a single atomic load gives a consistent view of both.
+     */
+    std::atomic<int64_t> last_event_;
 
-    std::shared_ptr<real_time_tools::RealTimeThread> thread_;
+    //! \brief End time of the previous action, only used by apply_action().
+    int64_t last_action_end_time_ns_;
+    internal::ActionTimingRecorder timing_recorder_;
+
+    std::shared_ptr<WatchdogService> watchdog_;
+    WatchdogService::ClientId watchdog_client_id_;
+    //! \brief Shuts down the driver after a timing violation.
+    std::thread shutdown_thread_;
 
     real_time_tools::SingletypeThreadsafeObject<std::string, 1> error_message_;
 
     /**
-     * @brief Monitor the timing of action execution.
+     * \brief Record the start or end of an action.
+     *
+     * @return Time of the event in nanoseconds.
+     */
+    int64_t record_event(const bool is_action_start)
+    {
+        const int64_t time_ns =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                Clock::now().time_since_epoch())
+                .count();
+        last_event_.store((time_ns << 1) | (is_action_start ? 1 : 0),
+                          std::memory_order_release);
+        return time_ns;
+    }
+
+    static Clock::duration to_clock_duration(const double duration_s)
+    {
+        if (!std::isfinite(duration_s))
+        {
+            return Clock::duration::max();
+        }
+        return std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(duration_s));
+    }
+
+    /**
+     * @brief Check the timing of action execution.
      *
-     * If one of the timing constrains is violated, the robot is immediately
-     * shut down.
+     * Called by the watchdog.  If one of the hard thresholds is exceeded,
+     * no more actions are accepted and the driver is shut down in a separate
+     * thread.  This way a slow shutdown (e.g. moving to a rest pose) does not
+     * block the watchdog, which may monitor other drivers as well.
+     *
+     * New events are not notified to the watchdog (to keep apply_action()
+     * lock-free), so the next check is scheduled early enough to still catch
+     * the deadline that follows from the next event, i.e. at most
+     * min(max_action_duration_, max_inter_action_duration_) later.
+     *
+     * @return False if monitoring ends, true otherwise.
      */
-    void loop()
+    bool check_timing(const Clock::time_point &now,
+                      Clock::time_point &next_check)
     {
+        if (is_shutdown_)
+        {
+            return false;
+        }
+
+        const int64_t event = last_event_.load(std::memory_order_acquire);
+
         // wait for the first data
-        while (!is_shutdown_ &&
-               !action_start_logger_.wait_for_timeindex(0, 0.1))
+        if (event == NO_EVENT)
         {
+            next_check = now + std::chrono::milliseconds(100);
+            return true;
         }
 
-        // loop until shutdown and monitor action timing
-        for (size_t t = 0; !is_shutdown_; t++)
+        const bool is_action_running = event & 1;
+        const Clock::time_point event_time(
+            std::chrono::duration_cast<Clock::duration>(
+                std::chrono::nanoseconds(event >> 1)));
+        const Clock::time_point deadline =
+            event_time + (is_action_running ? max_action_duration_
+                                            : max_inter_action_duration_);
+
+        // no new event until the deadline
+        if (now >= deadline)
         {
-            bool action_has_ended_on_time =
-                action_end_logger_.wait_for_timeindex(t,
-                                                      max_action_duration_s_);
-            if (!action_has_ended_on_time)
+            if (is_action_running)
             {
                 error_message_.set(
                     "Action did not end on time, shutting down.");
-                shutdown();
-                return;
             }
-            bool action_has_started_on_time =
-                action_start_logger_.wait_for_timeindex(
-                    t + 1, max_inter_action_duration_s_);
-            if (!action_has_started_on_time)
+            else
             {
                 error_message_.set(
                     "Action did not start on time, shutting down.");
-                shutdown();
-                return;
             }
+            if (!is_shutdown_.exchange(true))
+            {
+                shutdown_thread_ =
+                    std::thread([this]() { robot_driver_->shutdown(); });
+            }
+            return false;
         }
-    }
 
-    static void *loop(void *instance_pointer)
-    {
-        ((MonitoredRobotDriver *)(instance_pointer))->loop();
-        return nullptr;
+        next_check = std::min(
+            deadline,
+            now + (is_action_running ? max_inter_action_duration_
+                                     : max_action_duration_));
+        return true;
     }
 };
 
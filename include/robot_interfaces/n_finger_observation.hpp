@@ -6,13 +6,10 @@
  */
 #pragma once
 
-#include <string>
-#include <vector>
-
 #include <Eigen/Eigen>
 #include <serialization_utils/cereal_eigen.hpp>
 
-#include <robot_interfaces/loggable.hpp>
+#include <robot_interfaces/loggable_serialization.hpp>
 
 namespace robot_interfaces
 {
@@ -22,7 +19,8 @@ namespace robot_interfaces
  * @tparam N_FINGERS  Number of fingers.
  */
 template <size_t N_FINGERS>
-struct NFingerObservation : public Loggable
+struct NFingerObservation
+    : public SerializedLoggable<NFingerObservation<N_FINGERS>>
 {
     static constexpr size_t num_fingers = N_FINGERS;
     static constexpr size_t num_joints = N_FINGERS * 3;
@@ -38,29 +36,10 @@ struct NFingerObservation : public Loggable
     template <class Archive>
     void serialize(Archive& archive)
     {
-        archive(position, velocity, torque, tip_force);
-    }
-
-    std::vector<std::string> get_name() override
-    {
-        return {"position", "velocity", "torque", "tip_force"};
-    }
-
-    std::vector<std::vector<double>> get_data() override
-    {
-        typedef std::vector<double> vecd;
-
-        std::vector<vecd> result = {vecd(position.size()),
-                                    vecd(velocity.size()),
-                                    vecd(torque.size()),
-                                    vecd(tip_force.size())};
-
-        JointVector::Map(&result[0][0], position.size()) = position;
-        JointVector::Map(&result[1][0], velocity.size()) = velocity;
-        JointVector::Map(&result[2][0], torque.size()) = torque;
-        FingerVector::Map(&result[0][0], tip_force.size()) = tip_force;
-
-        return result;
+        archive(CEREAL_NVP(position),
+                CEREAL_NVP(velocity),
+                CEREAL_NVP(torque),
+                CEREAL_NVP(tip_force));
     }
 };
 }  // namespace robot_interfaces
@@ -7,13 +7,11 @@
 #pragma once
 
 #include <limits>
-#include <string>
-#include <vector>
 
 #include <Eigen/Eigen>
 #include <serialization_utils/cereal_eigen.hpp>
 
-#include <robot_interfaces/loggable.hpp>
+#include <robot_interfaces/loggable_serialization.hpp>
 
 namespace robot_interfaces
 {
@@ -26,7 +24,7 @@ namespace robot_interfaces
  * @tparam N Number of joints.
  */
 template <size_t N>
-struct NJointAction : public Loggable
+struct NJointAction : public SerializedLoggable<NJointAction<N>>
 {
     //! @brief Number of joints.
     static constexpr size_t num_joints = N;
@@ -45,39 +43,10 @@ struct NJointAction : public Loggable
     template <class Archive>
     void serialize(Archive& archive)
     {
-        archive(torque, position, position_kp, position_kd);
-    }
-
-    std::vector<std::string> get_name() override
-    {
-        return {"torque", "position", "position_kp", "position_kd"};
-    }
-
-    std::vector<std::vector<double>> get_data() override
-    {
-        // first map the Eigen vectors to std::vectors
-        std::vector<double> torque_;
-        torque_.resize(torque.size());
-        Vector::Map(&torque_[0], torque.size()) = torque;
-
-        std::vector<double> position_;
-        position_.resize(position.size());
-        Vector::Map(&position_[0], position.size()) = position;
-
-        std::vector<double> position_kp_;
-        position_kp_.resize(position_kp.size());
-        Vector::Map(&position_kp_[0], position_kp.size()) = position_kp;
-
-        std::vector<double> position_kd_;
-        position_kd_.resize(position_kd.size());
-        Vector::Map(&position_kd_[0], position_kd.size()) = position_kd;
-
-        // then return them in a fixed size vector of vectors to avoid
-        // copying due to pushing back value of information!
-        std::vector<std::vector<double>> result;
-        result = {torque_, position_, position_kp_, position_kd_};
-
-        return result;
+        archive(CEREAL_NVP(torque),
+                CEREAL_NVP(position),
+                CEREAL_NVP(position_kp),
+                CEREAL_NVP(position_kd));
     }
 
     /**
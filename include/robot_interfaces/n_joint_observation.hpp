@@ -6,13 +6,10 @@
  */
 #pragma once
 
-#include <string>
-#include <vector>
-
 #include <Eigen/Eigen>
 #include <serialization_utils/cereal_eigen.hpp>
 
-#include <robot_interfaces/loggable.hpp>
+#include <robot_interfaces/loggable_serialization.hpp>
 
 namespace robot_interfaces
 {
@@ -24,7 +21,7 @@ namespace robot_interfaces
  * @tparam N Number of joints.
  */
 template <size_t N>
-struct NJointObservation : public Loggable
+struct NJointObservation : public SerializedLoggable<NJointObservation<N>>
 {
     //! @brief Number of joints.
     static constexpr size_t num_joints = N;
@@ -38,26 +35,9 @@ struct NJointObservation : public Loggable
     template <class Archive>
     void serialize(Archive& archive)
     {
-        archive(position, velocity, torque);
-    }
-
-    std::vector<std::string> get_name() override
-    {
-        return {"position", "velocity", "torque"};
-    }
-
-    std::vector<std::vector<double>> get_data() override
-    {
-        typedef std::vector<double> vecd;
-
-        std::vector<vecd> result = {
-            vecd(position.size()), vecd(velocity.size()), vecd(torque.size())};
-
-        Vector::Map(&result[0][0], position.size()) = position;
-        Vector::Map(&result[1][0], velocity.size()) = velocity;
-        Vector::Map(&result[2][0], torque.size()) = torque;
-
-        return result;
+        archive(CEREAL_NVP(position),
+                CEREAL_NVP(velocity),
+                CEREAL_NVP(torque));
     }
 };
 
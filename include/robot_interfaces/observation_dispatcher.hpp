@@ -0,0 +1,344 @@
+/**
+ * @file
+ * @brief Thread that passes new observations to subscribed callbacks.
+ * @copyright 2020, Max Planck Gesellschaft. All rights reserved.
+ * @license BSD 3-clause
+ */
+#pragma once
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <pybind11/embed.h>
+
+#include <time_series/interface.hpp>
+
+#include <robot_interfaces/control_block.hpp>
+
+namespace robot_interfaces
+{
+/**
+ * @brief Passes new observations of a time series to subscribed callbacks.
+ *
+ * A single dispatcher thread waits for new observations, reads each of them
+ * once and passes them to all subscribers.  This way any number of consumers
+ * within the process can be served without each of them waiting on the time
+ * series.
+ *
+ * Observations are passed in batches of consecutive observations.  Normally a
+ * batch contains only one observation, but if the callbacks take longer than
+ * the time between two observations, the observations that arrived in the
+ * meantime are passed together.  If the dispatcher falls behind so far that
+ * observations are dropped from the time series, they are skipped (see
+ * get_number_of_skipped_observations()).  Exceptions thrown by callbacks are
+ * caught and logged, so a failing subscriber does not affect the others (see
+ * get_number_of_failed_callbacks()).
+ *
+ * The dispatcher thread is started with the first subscription.  Subscribers
+ * only get observations that arrive after the first subscription was made.
+ *
+ * @tparam Observation
+ */
+template <typename Observation>
+class ObservationDispatcher
+{
+public:
+    typedef time_series::Index TimeIndex;
+    typedef uint64_t SubscriptionId;
+
+    /**
+     * @brief Callback for new observations.
+     *
+     * Arguments are the time index of the first observation of the batch and
+     * the batch of consecutive observations.
+     *
+     * Callbacks are executed one after another in the dispatcher thread, so
+     * they should return quickly.  They must not call subscribe() or
+     * unsubscribe() of the dispatcher.
+     */
+    typedef std::function<void(const TimeIndex &first_timeindex,
+                               const std::vector<Observation> &observations)>
+        Callback;
+
+    /**
+     * @param observations  The time series of observations.
+     * @param control_block  If set, the dispatcher sleeps on the control block
+     *     (see ControlBlock::wait()) and is woken up as soon as the backend
+     *     publishes a new observation.  Otherwise it waits on the time series.
+     * @param max_batch_size  Maximum number of observations per batch.
+     */
+    ObservationDispatcher(
+        std::shared_ptr<time_series::TimeSeriesInterface<Observation>>
+            observations,
+        std::shared_ptr<ControlBlock> control_block = nullptr,
+        const size_t max_batch_size = 100)
+        : observations_(observations),
+          control_block_(control_block),
+          max_batch_size_(max_batch_size),
+          next_subscription_id_(0),
+          is_stop_requested_(false),
+          num_skipped_observations_(0),
+          num_failed_callbacks_(0),
+          event_fd_(-1)
+    {
+    }
+
+    //! @brief Stops the dispatcher thread.
+    ~ObservationDispatcher()
+    {
+        // Release the GIL (if there is one) as the dispatcher thread may need
+        // it to finish a callback implemented in Python.  See RobotBackend
+        // for why Py_IsInitialized() is checked.
+        if (Py_IsInitialized())
+        {
+            pybind11::gil_scoped_release release;
+            stop();
+        }
+        else
+        {
+            stop();
+        }
+
+        if (event_fd_ >= 0)
+        {
+            close(event_fd_);
+        }
+    }
+
+    /**
+     * @brief Subscribe to new observations.
+     *
+     * @param callback  Function that is called with new observations.
+     * @return ID of the subscription, to be used for unsubscribe().
+     */
+    SubscriptionId subscribe(Callback callback)
+    {
+        std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+
+        const SubscriptionId id = next_subscription_id_++;
+        subscriptions_[id] = std::move(callback);
+
+        if (!thread_.joinable())
+        {
+            // determine the first index here, so no observation is missed if
+            // the thread takes some time to start
+            thread_ = std::thread(&ObservationDispatcher::loop,
+                                  this,
+                                  observations_->newest_timeindex(false) + 1);
+        }
+
+        return id;
+    }
+
+    /**
+     * @brief Cancel a subscription.
+     *
+     * When this returns, the callback of the subscription is not running and
+     * will not be called anymore.
+     */
+    void unsubscribe(const SubscriptionId id)
+    {
+        std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+        subscriptions_.erase(id);
+    }
+
+    /**
+     * @brief Get an eventfd that is signalled when new observations arrive.
+     *
+     * The file descriptor becomes readable when new observations arrive, so it
+     * can be used with poll/epoll/select together with other file
+     * descriptors.  Reading it returns the number of new observations since
+     * the last read (as 8 byte integer) and resets it to zero.  The
+     * observations themselves are then to be read from the time series.
+     *
+     * The eventfd is created (and subscribed) on the first call.  All calls
+     * return the same file descriptor, which is non-blocking and owned by the
+     * dispatcher, i.e. it must not be closed by the caller.
+     */
+    int get_event_fd()
+    {
+        std::lock_guard<std::mutex> lock(event_fd_mutex_);
+
+        if (event_fd_ < 0)
+        {
+            event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (event_fd_ < 0)
+            {
+                throw std::system_error(
+                    errno, std::generic_category(), "Failed to create eventfd");
+            }
+
+            const int fd = event_fd_;
+            subscribe([fd](const TimeIndex &,
+                           const std::vector<Observation> &observations) {
+                const uint64_t count = observations.size();
+                // only fails if the counter would overflow, which means
+                // nobody is reading it anyway
+                ssize_t ret = write(fd, &count, sizeof(count));
+                (void)ret;
+            });
+        }
+
+        return event_fd_;
+    }
+
+    //! @brief Number of observations that were dropped before dispatching.
+    uint64_t get_number_of_skipped_observations() const
+    {
+        return num_skipped_observations_;
+    }
+
+    //! @brief Number of callback calls that threw an exception.
+    uint64_t get_number_of_failed_callbacks() const
+    {
+        return num_failed_callbacks_;
+    }
+
+private:
+    std::shared_ptr<time_series::TimeSeriesInterface<Observation>>
+        observations_;
+    std::shared_ptr<ControlBlock> control_block_;
+    const size_t max_batch_size_;
+
+    std::map<SubscriptionId, Callback> subscriptions_;
+    SubscriptionId next_subscription_id_;
+    std::mutex subscriptions_mutex_;
+
+    std::atomic<bool> is_stop_requested_;
+    std::atomic<uint64_t> num_skipped_observations_;
+    std::atomic<uint64_t> num_failed_callbacks_;
+    std::thread thread_;
+
+    int event_fd_;
+    std::mutex event_fd_mutex_;
+
+    void stop()
+    {
+        is_stop_requested_ = true;
+        if (control_block_)
+        {
+            control_block_->notify();
+        }
+        if (thread_.joinable())
+        {
+            thread_.join();
+        }
+    }
+
+    /**
+     * @brief Wait until the observation with index t is available.
+     *
+     * Times out after 0.1 s, so the caller can check for stop requests.
+     *
+     * @return True if the observation is available.
+     */
+    bool wait_for_observation(const TimeIndex t)
+    {
+        if (control_block_)
+        {
+            control_block_->wait(
+                [&]() {
+                    return control_block_->newest_observation.load() >= t ||
+                           is_stop_requested_;
+                },
+                0.1);
+            return observations_->newest_timeindex(false) >= t;
+        }
+        else
+        {
+            return observations_->wait_for_timeindex(t, 0.1);
+        }
+    }
+
+    //! @brief Call a callback, catching and logging its exceptions.
+    void call(const SubscriptionId id,
+              Callback &callback,
+              const TimeIndex first_t,
+              const std::vector<Observation> &batch)
+    {
+        try
+        {
+            callback(first_t, batch);
+        }
+        catch (const std::exception &e)
+        {
+            num_failed_callbacks_++;
+            std::cerr << "Observation callback of subscription " << id
+                      << " failed: " << e.what() << std::endl;
+        }
+        catch (...)
+        {
+            num_failed_callbacks_++;
+            std::cerr << "Observation callback of subscription " << id
+                      << " failed." << std::endl;
+        }
+    }
+
+    void loop(TimeIndex next_t)
+    {
+        std::vector<Observation> batch;
+        batch.reserve(max_batch_size_);
+
+        while (!is_stop_requested_)
+        {
+            if (!wait_for_observation(next_t))
+            {
+                continue;
+            }
+
+            const TimeIndex oldest_t = observations_->oldest_timeindex(false);
+            if (next_t < oldest_t)
+            {
+                num_skipped_observations_ += oldest_t - next_t;
+                next_t = oldest_t;
+            }
+            const TimeIndex last_t =
+                std::min(observations_->newest_timeindex(false),
+                         next_t + static_cast<TimeIndex>(max_batch_size_) - 1);
+
+            batch.clear();
+            try
+            {
+                for (TimeIndex t = next_t; t <= last_t; t++)
+                {
+                    batch.push_back((*observations_)[t]);
+                }
+            }
+            catch (const std::exception &)
+            {
+                // The observation was dropped from the history after the
+                // check above.  Retry, the dropped observations are then
+                // skipped and counted.
+                continue;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+                for (auto &subscription : subscriptions_)
+                {
+                    call(subscription.first,
+                         subscription.second,
+                         next_t,
+                         batch);
+                }
+            }
+
+            next_t = last_t + 1;
+        }
+    }
+};
+
+}  // namespace robot_interfaces
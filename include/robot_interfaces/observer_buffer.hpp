@@ -0,0 +1,382 @@
+/**
+ * @file
+ * @brief Lock-free buffer of the newest observations for passive observers.
+ * @copyright 2020, Max Planck Gesellschaft. All rights reserved.
+ * @license BSD 3-clause
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <time_series/interface.hpp>
+
+#include "control_block.hpp"
+#include "seqlock_slot.hpp"
+#include "status.hpp"
+#include "timing_statistics.hpp"
+
+namespace robot_interfaces
+{
+namespace internal
+{
+//! @brief Header of the memory of an ObserverBuffer.
+struct ObserverBufferHeader
+{
+    uint64_t num_slots;
+    uint64_t slot_size;
+    //! @brief Newest time index of the observations.
+    std::atomic<int64_t> newest_observation;
+};
+}  // namespace internal
+
+/**
+ * @brief Get the shared memory ID of the ObserverBuffer of a
+ *     MultiProcessRobotData.
+ *
+ * @param shared_memory_id_prefix  Prefix passed to MultiProcessRobotData.
+ */
+inline std::string get_observer_buffer_shared_memory_id(
+    const std::string &shared_memory_id_prefix)
+{
+    return shared_memory_id_prefix + "_observer";
+}
+
+/**
+ * @brief Buffer of the newest observations and status for passive observers.
+ *
+ * The backend publishes each observation (and the status of each step) to
+ * this buffer in addition to the RobotData time series.  In contrast to the
+ * time series, reading from the buffer never takes a lock: each element is
+ * stored in a slot that is protected by a sequence number (see
+ * internal::SeqlockSlotHeader).  This way, readers can never delay the
+ * writer, no matter how many of them there are and how slow they are.
+ *
+ * The observations are stored in a ring of slots, so a limited history is
+ * available.  Of the status, only the newest one is kept.
+ *
+ * Elements are serialized with cereal into slots of fixed size.  Elements
+ * that do not fit into a slot are not published (see
+ * get_number_of_oversized_elements()), so make sure to choose the slot size
+ * large enough if the serialized size of observations varies.
+ *
+ * For use in multiple processes, the buffer is placed in shared memory.  It
+ * is created by the writer and can be opened read-only by any number of
+ * observers (see the constructors).
+ *
+ * @tparam Observation
+ */
+template <typename Observation>
+class ObserverBuffer
+{
+public:
+    typedef time_series::Index TimeIndex;
+
+    /**
+     * @brief Create a buffer for use within a single process.
+     *
+     * @param num_slots  Number of observations that are kept.
+     * @param slot_size  Maximum size of a serialized element in bytes.  If
+     *     zero, a size based on a default-constructed Observation is chosen
+     *     (see get_default_slot_size()).
+     */
+    ObserverBuffer(const size_t num_slots, const size_t slot_size = 0)
+        : is_writable_(true)
+    {
+        const size_t size = get_slot_size(slot_size);
+        auto memory = std::make_shared<std::vector<uint64_t>>(
+            (get_memory_size(num_slots, size) + sizeof(uint64_t) - 1) /
+            sizeof(uint64_t));
+        memory_owner_ = memory;
+        initialize(reinterpret_cast<char *>(memory->data()), num_slots, size);
+    }
+
+    /**
+     * @brief Create a buffer in shared memory, to be written by this process.
+     *
+     * An existing buffer with the same ID is replaced.  Observers that still
+     * have the old one opened do not see the new data.
+     *
+     * @param shared_memory_id  ID of the shared memory.
+     * @param num_slots  Number of observations that are kept.
+     * @param slot_size  See ObserverBuffer(size_t, size_t).
+     */
+    ObserverBuffer(const std::string &shared_memory_id,
+                   const size_t num_slots,
+                   const size_t slot_size = 0)
+        : is_writable_(true)
+    {
+        namespace bip = boost::interprocess;
+
+        const size_t size = get_slot_size(slot_size);
+
+        clear_memory(shared_memory_id);
+        auto memory = std::make_shared<internal::SharedMemoryMapping>();
+        memory->object = bip::shared_memory_object(
+            bip::create_only, shared_memory_id.c_str(), bip::read_write);
+        memory->object.truncate(get_memory_size(num_slots, size));
+        memory->region = bip::mapped_region(memory->object, bip::read_write);
+        memory_owner_ = memory;
+
+        initialize(static_cast<char *>(memory->region.get_address()),
+                   num_slots,
+                   size);
+    }
+
+    /**
+     * @brief Open an existing buffer in shared memory for reading.
+     *
+     * The memory is mapped read-only, so the observer cannot affect the
+     * writer in any way.
+     *
+     * @param shared_memory_id  ID of the shared memory.
+     */
+    explicit ObserverBuffer(const std::string &shared_memory_id)
+        : is_writable_(false)
+    {
+        namespace bip = boost::interprocess;
+
+        auto memory = std::make_shared<internal::SharedMemoryMapping>();
+        memory->object = bip::shared_memory_object(
+            bip::open_only, shared_memory_id.c_str(), bip::read_only);
+        memory->region = bip::mapped_region(memory->object, bip::read_only);
+        memory_owner_ = memory;
+
+        char *base = static_cast<char *>(memory->region.get_address());
+        header_ = reinterpret_cast<internal::ObserverBufferHeader *>(base);
+        const std::string error_message =
+            "Shared memory " + shared_memory_id +
+            " does not contain an initialised ObserverBuffer.";
+        if (memory->region.get_size() < get_header_size() ||
+            header_->num_slots == 0)
+        {
+            throw std::runtime_error(error_message);
+        }
+        // the number of slots is set last by the writer, see initialize()
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (memory->region.get_size() <
+            get_memory_size(header_->num_slots, header_->slot_size))
+        {
+            throw std::runtime_error(error_message);
+        }
+        set_pointers(base);
+    }
+
+    //! @brief Remove the shared memory of a buffer.
+    static void clear_memory(const std::string &shared_memory_id)
+    {
+        boost::interprocess::shared_memory_object::remove(
+            shared_memory_id.c_str());
+    }
+
+    //! @brief Slot size used if none is specified, see
+    //! internal::get_default_slot_size().
+    static size_t get_default_slot_size()
+    {
+        return internal::get_default_slot_size<Observation>();
+    }
+
+    /**
+     * @brief Publish an observation.
+     *
+     * Only to be called by the writer (i.e. the backend).
+     *
+     * @return False if the observation does not fit into a slot.
+     */
+    bool publish_observation(const TimeIndex t,
+                             const double timestamp_ms,
+                             const Observation &observation)
+    {
+        const bool is_published = write_slot(
+            get_observation_slot(t), t, timestamp_ms, observation);
+        if (is_published)
+        {
+            publish_timeindex(header_->newest_observation, t);
+        }
+        return is_published;
+    }
+
+    /**
+     * @brief Publish the status of a step.
+     *
+     * Only to be called by the writer (i.e. the backend).
+     *
+     * @return False if the status does not fit into a slot.
+     */
+    bool publish_status(const TimeIndex t,
+                        const double timestamp_ms,
+                        const Status &status)
+    {
+        return write_slot(status_slot_, t, timestamp_ms, status);
+    }
+
+    //! @brief Newest time index of the observations (EMPTY if there is none).
+    TimeIndex newest_observation_timeindex() const
+    {
+        return header_->newest_observation.load();
+    }
+
+    //! @brief Oldest time index of the observations that may still be read.
+    TimeIndex oldest_observation_timeindex() const
+    {
+        const TimeIndex newest = newest_observation_timeindex();
+        if (newest == time_series::EMPTY)
+        {
+            return time_series::EMPTY;
+        }
+        return std::max<TimeIndex>(
+            0, newest - static_cast<TimeIndex>(header_->num_slots) + 1);
+    }
+
+    /**
+     * @brief Read the observation with time index t.
+     *
+     * Never blocks and never takes a lock.
+     *
+     * @param t  Time index of the observation.
+     * @param observation  Set to the observation if it is available.
+     * @param timestamp_ms  If not null, set to the time at which the
+     *     observation was published.
+     *
+     * @return False if the observation is not available (i.e. it does not
+     *     exist yet, was already overwritten or did not fit into the slot).
+     */
+    bool read_observation(const TimeIndex t,
+                          Observation &observation,
+                          double *timestamp_ms = nullptr) const
+    {
+        if (t < 0)
+        {
+            return false;
+        }
+        TimeIndex slot_timeindex;
+        return internal::read_seqlock_slot(get_observation_slot(t),
+                                           header_->slot_size,
+                                           observation,
+                                           slot_timeindex,
+                                           timestamp_ms) &&
+               slot_timeindex == t;
+    }
+
+    /**
+     * @brief Read the newest status.
+     *
+     * Never blocks and never takes a lock.
+     *
+     * @param status  Set to the status if there is one.
+     * @param t  Set to the time index of the status.
+     *
+     * @return False if no status is available.
+     */
+    bool read_status(Status &status, TimeIndex &t) const
+    {
+        return internal::read_seqlock_slot(
+            status_slot_, header_->slot_size, status, t);
+    }
+
+    //! @brief Number of elements that were not published as they were too
+    //! large for a slot.  Only counted in the process of the writer.
+    uint64_t get_number_of_oversized_elements() const
+    {
+        return num_oversized_elements_;
+    }
+
+private:
+    typedef internal::SeqlockSlotHeader SlotHeader;
+
+    const bool is_writable_;
+    std::shared_ptr<void> memory_owner_;
+    internal::ObserverBufferHeader *header_;
+    SlotHeader *status_slot_;
+    char *observation_slots_;
+    size_t slot_stride_;
+
+    std::unique_ptr<internal::SeqlockSlotWriter> writer_;
+    std::atomic<uint64_t> num_oversized_elements_{0};
+
+    static size_t get_slot_size(const size_t slot_size)
+    {
+        return slot_size > 0 ? slot_size : get_default_slot_size();
+    }
+
+    static size_t get_header_size()
+    {
+        return SlotHeader::align(sizeof(internal::ObserverBufferHeader));
+    }
+
+    static size_t get_memory_size(const size_t num_slots,
+                                  const size_t slot_size)
+    {
+        // header, status slot and observation slots
+        return get_header_size() +
+               (num_slots + 1) * SlotHeader::get_stride(slot_size);
+    }
+
+    void initialize(char *base, const size_t num_slots, const size_t slot_size)
+    {
+        if (num_slots == 0)
+        {
+            throw std::invalid_argument("num_slots must be greater than zero.");
+        }
+
+        header_ = new (base) internal::ObserverBufferHeader();
+        header_->num_slots = 0;
+        header_->slot_size = slot_size;
+        header_->newest_observation = time_series::EMPTY;
+
+        set_pointers(base);
+
+        for (size_t i = 0; i < num_slots + 1; i++)
+        {
+            new (reinterpret_cast<char *>(status_slot_) + i * slot_stride_)
+                SlotHeader();
+        }
+
+        // Set the number of slots last, observers check it to see if the
+        // memory is initialised.
+        std::atomic_thread_fence(std::memory_order_release);
+        header_->num_slots = num_slots;
+
+        writer_.reset(new internal::SeqlockSlotWriter(slot_size));
+    }
+
+    void set_pointers(char *base)
+    {
+        slot_stride_ = SlotHeader::get_stride(header_->slot_size);
+        status_slot_ = reinterpret_cast<SlotHeader *>(base + get_header_size());
+        observation_slots_ = base + get_header_size() + slot_stride_;
+    }
+
+    SlotHeader *get_observation_slot(const TimeIndex t) const
+    {
+        return reinterpret_cast<SlotHeader *>(
+            observation_slots_ + (t % header_->num_slots) * slot_stride_);
+    }
+
+    template <typename T>
+    bool write_slot(SlotHeader *slot,
+                    const TimeIndex t,
+                    const double timestamp_ms,
+                    const T &value)
+    {
+        if (!is_writable_)
+        {
+            throw std::logic_error("ObserverBuffer is opened read-only.");
+        }
+
+        if (!writer_->write(slot, t, timestamp_ms, value))
+        {
+            internal::increment(num_oversized_elements_);
+            return false;
+        }
+        return true;
+    }
+};
+
+}  // namespace robot_interfaces
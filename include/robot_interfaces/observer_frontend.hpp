@@ -0,0 +1,215 @@
+/**
+ * @file
+ * @brief Read-only frontend for passive observers of a robot.
+ * @copyright 2020, Max Planck Gesellschaft. All rights reserved.
+ * @license BSD 3-clause
+ */
+#pragma once
+
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include <time_series/interface.hpp>
+
+#include "observer_buffer.hpp"
+#include "status.hpp"
+
+namespace robot_interfaces
+{
+/**
+ * @brief Read-only access to observations and status of a robot.
+ *
+ * Intended for passive observers like monitoring tools that only need to see
+ * what the robot is doing.  In contrast to RobotFrontend, it does not access
+ * the RobotData time series but the ObserverBuffer, which is mapped read-only
+ * and read without taking any locks.  So any number of observers can be
+ * attached without affecting the timing of the backend.
+ *
+ * The flip side is that only the observations and the newest status are
+ * available, only a limited history is kept and waiting is done by polling.
+ *
+ * @tparam Observation
+ */
+template <typename Observation>
+class ObserverFrontend
+{
+public:
+    typedef time_series::Index TimeIndex;
+
+    /**
+     * @brief Attach to the robot data of a MultiProcessRobotData.
+     *
+     * The master instance of the MultiProcessRobotData needs to exist
+     * already.  If the master is restarted, the observer needs to be
+     * recreated to see the new data.
+     *
+     * @param shared_memory_id_prefix  The prefix that was passed to
+     *     MultiProcessRobotData.
+     */
+    explicit ObserverFrontend(const std::string &shared_memory_id_prefix)
+        : buffer_(std::make_shared<ObserverBuffer<Observation>>(
+              get_observer_buffer_shared_memory_id(shared_memory_id_prefix)))
+    {
+    }
+
+    //! @brief Use the given buffer (e.g. RobotData::observer_buffer).
+    explicit ObserverFrontend(
+        std::shared_ptr<ObserverBuffer<Observation>> buffer)
+        : buffer_(buffer)
+    {
+        if (!buffer_)
+        {
+            throw std::invalid_argument("No ObserverBuffer given.");
+        }
+    }
+
+    //! @brief Time index of the newest observation (EMPTY if there is none).
+    TimeIndex get_current_timeindex() const
+    {
+        return buffer_->newest_observation_timeindex();
+    }
+
+    //! @brief Oldest time index that is still available.
+    TimeIndex get_oldest_timeindex() const
+    {
+        return buffer_->oldest_observation_timeindex();
+    }
+
+    /**
+     * @brief Get the observation with time index t.
+     *
+     * Does not wait for the observation, see wait_until_timeindex().
+     *
+     * @throws std::invalid_argument if the observation is not available.
+     */
+    Observation get_observation(const TimeIndex t) const
+    {
+        Observation observation;
+        read_observation(t, observation, nullptr);
+        return observation;
+    }
+
+    /**
+     * @brief Call a function with the observation of time index t.
+     *
+     * The observation is deserialised directly into the object that is
+     * passed to the visitor.  See also RobotFrontend::with_observation().
+     *
+     * @throws std::invalid_argument if the observation is not available.
+     */
+    template <typename Visitor>
+    auto with_observation(const TimeIndex t, Visitor visitor) const
+        -> decltype(visitor(std::declval<const Observation &>()))
+    {
+        Observation observation;
+        read_observation(t, observation, nullptr);
+        return visitor(static_cast<const Observation &>(observation));
+    }
+
+    /**
+     * @brief Get the time at which observation t was recorded.
+     *
+     * @throws std::invalid_argument if the observation is not available.
+     */
+    double get_timestamp_ms(const TimeIndex t) const
+    {
+        Observation observation;
+        double timestamp_ms;
+        read_observation(t, observation, &timestamp_ms);
+        return timestamp_ms;
+    }
+
+    /**
+     * @brief Get the newest observation.
+     *
+     * @throws std::runtime_error if there is no observation yet.
+     */
+    Observation get_latest_observation() const
+    {
+        Observation observation;
+        while (true)
+        {
+            const TimeIndex t = get_current_timeindex();
+            if (t == time_series::EMPTY)
+            {
+                throw std::runtime_error("There is no observation yet.");
+            }
+            // can only fail if the slot was overwritten in the meantime, so
+            // simply try again with the newer one
+            if (buffer_->read_observation(t, observation))
+            {
+                return observation;
+            }
+        }
+    }
+
+    /**
+     * @brief Get the newest status.
+     *
+     * @return The status or a default-constructed one if there is none yet.
+     */
+    Status get_latest_status() const
+    {
+        Status status;
+        TimeIndex t;
+        buffer_->read_status(status, t);
+        return status;
+    }
+
+    /**
+     * @brief Wait until the observation with index t is available.
+     *
+     * As observers must not interfere with the backend, this polls the
+     * buffer.
+     *
+     * @param t  The time index to wait for.
+     * @param max_duration_s  Maximum time to wait.
+     * @param poll_interval_s  Time between two checks.
+     *
+     * @return True if the time index is reached, false if timeout occurred.
+     */
+    bool wait_until_timeindex(
+        const TimeIndex t,
+        const double max_duration_s = std::numeric_limits<double>::infinity(),
+        const double poll_interval_s = 0.001) const
+    {
+        typedef std::chrono::steady_clock Clock;
+        const Clock::time_point start = Clock::now();
+
+        while (get_current_timeindex() < t)
+        {
+            if (std::chrono::duration<double>(Clock::now() - start).count() >
+                max_duration_s)
+            {
+                return false;
+            }
+            std::this_thread::sleep_for(
+                std::chrono::duration<double>(poll_interval_s));
+        }
+        return true;
+    }
+
+private:
+    std::shared_ptr<ObserverBuffer<Observation>> buffer_;
+
+    void read_observation(const TimeIndex t,
+                          Observation &observation,
+                          double *timestamp_ms) const
+    {
+        if (!buffer_->read_observation(t, observation, timestamp_ms))
+        {
+            throw std::invalid_argument(
+                "Observation " + std::to_string(t) +
+                " is not available.  Newest is " +
+                std::to_string(get_current_timeindex()) + ", oldest is " +
+                std::to_string(get_oldest_timeindex()) + ".");
+        }
+    }
+};
+
+}  // namespace robot_interfaces
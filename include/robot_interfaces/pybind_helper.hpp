@@ -19,12 +19,17 @@
  * \file
  * \brief Helper functions for creating Python bindings.
  */
+#include <string>
+#include <tuple>
 #include <type_traits>
 
 #include <pybind11/eigen.h>
+#include <pybind11/functional.h>
 #include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
 #include <pybind11/stl_bind.h>
 
+#include <robot_interfaces/monitored_robot_driver.hpp>
 #include <robot_interfaces/robot_frontend.hpp>
 
 namespace robot_interfaces
@@ -78,20 +83,58 @@ template <typename Types>
 void create_python_bindings(pybind11::module &m)
 {
     pybind11::class_<typename Types::BaseData, typename Types::BaseDataPtr>(
-        m, "BaseData");
+        m, "BaseData")
+        .def_readwrite("wait_strategy", &Types::BaseData::wait_strategy);
 
     pybind11::class_<typename Types::SingleProcessData,
                      typename Types::SingleProcessDataPtr,
                      typename Types::BaseData>(m, "SingleProcessData")
-        .def(pybind11::init<size_t>(), pybind11::arg("history_size") = 1000);
+        .def(pybind11::init<size_t, uint32_t>(),
+             pybind11::arg("history_size") = 1000,
+             pybind11::arg("observations_per_action") = 1);
 
     pybind11::class_<typename Types::MultiProcessData,
                      typename Types::MultiProcessDataPtr,
                      typename Types::BaseData>(m, "MultiProcessData")
-        .def(pybind11::init<std::string, bool, size_t>(),
+        .def(pybind11::init<std::string,
+                            bool,
+                            size_t,
+                            uint32_t,
+                            bool,
+                            size_t>(),
              pybind11::arg("shared_memory_id_prefix"),
              pybind11::arg("is_master"),
-             pybind11::arg("history_size") = 1000);
+             pybind11::arg("history_size") = 1000,
+             pybind11::arg("observations_per_action") = 1,
+             pybind11::arg("reattach") = false,
+             pybind11::arg("max_action_clients") = 8)
+        .def_static("clear_memory", &Types::MultiProcessData::clear_memory);
+
+    pybind11::class_<typename Types::RemoteData,
+                     typename Types::RemoteDataPtr,
+                     typename Types::BaseData>(m, "RemoteData")
+        .def(pybind11::init<std::string, uint16_t, size_t>(),
+             pybind11::arg("host"),
+             pybind11::arg("port"),
+             pybind11::arg("history_size") = 1000)
+        .def("is_connected", &Types::RemoteData::is_connected)
+        .def("get_transport_statistics",
+             &Types::RemoteData::get_transport_statistics);
+
+    pybind11::class_<typename Types::RemoteBridge,
+                     typename Types::RemoteBridgePtr>(m, "RemoteBridge")
+        .def(pybind11::init<typename Types::BaseDataPtr,
+                            uint16_t,
+                            bool,
+                            double>(),
+             pybind11::arg("robot_data"),
+             pybind11::arg("port"),
+             pybind11::arg("loopback_only") = true,
+             pybind11::arg("poll_interval_s") = 0.001)
+        .def("get_port", &Types::RemoteBridge::get_port)
+        .def("is_connected", &Types::RemoteBridge::is_connected)
+        .def("get_transport_statistics",
+             &Types::RemoteBridge::get_transport_statistics);
 
     pybind11::class_<typename Types::Backend, typename Types::BackendPtr>(
         m, "Backend")
@@ -100,7 +143,12 @@ void create_python_bindings(pybind11::module &m)
              pybind11::call_guard<pybind11::gil_scoped_release>())
         .def("wait_until_terminated",
              &Types::Backend::wait_until_terminated,
-             pybind11::call_guard<pybind11::gil_scoped_release>());
+             pybind11::call_guard<pybind11::gil_scoped_release>())
+        .def("set_max_step_duration", &Types::Backend::set_max_step_duration)
+        .def("step",
+             &Types::Backend::step,
+             pybind11::call_guard<pybind11::gil_scoped_release>())
+        .def("is_running", &Types::Backend::is_running);
 
     pybind11::class_<typename Types::Action>(m, "Action")
         .def_readwrite("torque", &Types::Action::torque)
@@ -123,6 +171,34 @@ void create_python_bindings(pybind11::module &m)
                    .def_readwrite("torque", &Types::Observation::torque);
     BindTipForceIfExists<Types>::bind(obs);
 
+    pybind11::class_<typename Types::Frontend::AppendResult>(m,
+                                                             "AppendResult")
+        .def_readonly("appended", &Types::Frontend::AppendResult::appended)
+        .def_readonly("timeindex", &Types::Frontend::AppendResult::timeindex)
+        .def_readonly("queued", &Types::Frontend::AppendResult::queued);
+
+    pybind11::class_<typename Types::Frontend::ActionDeadline>(
+        m, "ActionDeadline")
+        .def_readonly("timeindex",
+                      &Types::Frontend::ActionDeadline::timeindex)
+        .def_readonly("time_until_needed_s",
+                      &Types::Frontend::ActionDeadline::time_until_needed_s)
+        .def_readonly("time_until_error_s",
+                      &Types::Frontend::ActionDeadline::time_until_error_s)
+        .def_readonly("step_period_s",
+                      &Types::Frontend::ActionDeadline::step_period_s);
+
+    pybind11::class_<typename Types::ActionClient,
+                     typename Types::ActionClientPtr>(m, "ActionClient")
+        .def("submit",
+             &Types::ActionClient::submit,
+             pybind11::arg("action"),
+             pybind11::arg("validity_s") =
+                 Types::ActionClient::default_validity_s)
+        .def("withdraw", &Types::ActionClient::withdraw)
+        .def("set_priority", &Types::ActionClient::set_priority)
+        .def("get_priority", &Types::ActionClient::get_priority);
+
     // Release the GIL when calling any of the front-end functions, so in case
     // there are subthreads running Python, they have a chance to acquire the
     // GIL.
@@ -156,19 +232,150 @@ void create_python_bindings(pybind11::module &m)
              &Types::Frontend::get_timestamp_ms,
              pybind11::call_guard<pybind11::gil_scoped_release>())
         .def("append_desired_action",
-             &Types::Frontend::append_desired_action,
+             static_cast<TimeIndex (Types::Frontend::*)(
+                 const typename Types::Action &)>(
+                 &Types::Frontend::append_desired_action),
+             pybind11::call_guard<pybind11::gil_scoped_release>())
+        .def("append_desired_action",
+             static_cast<typename Types::Frontend::AppendResult (
+                 Types::Frontend::*)(const typename Types::Action &,
+                                     const double)>(
+                 &Types::Frontend::append_desired_action),
+             pybind11::arg("desired_action"),
+             pybind11::arg("max_duration_s"),
+             pybind11::call_guard<pybind11::gil_scoped_release>())
+        .def("try_append_desired_action",
+             &Types::Frontend::try_append_desired_action,
+             pybind11::call_guard<pybind11::gil_scoped_release>())
+        .def("get_number_of_blocked_appends",
+             &Types::Frontend::get_number_of_blocked_appends)
+        .def("get_action_deadline", &Types::Frontend::get_action_deadline)
+        .def("create_action_client",
+             &Types::Frontend::create_action_client,
+             pybind11::arg("priority"))
+        .def("wait_until_time_index",
+             static_cast<void (Types::Frontend::*)(const TimeIndex &) const>(
+                 &Types::Frontend::wait_until_timeindex),
              pybind11::call_guard<pybind11::gil_scoped_release>())
         .def("wait_until_time_index",
-             &Types::Frontend::wait_until_timeindex,
+             static_cast<bool (Types::Frontend::*)(const TimeIndex &,
+                                                   const double) const>(
+                 &Types::Frontend::wait_until_timeindex),
+             pybind11::arg("t"),
+             pybind11::arg("max_duration_s"),
+             pybind11::call_guard<pybind11::gil_scoped_release>())
+        .def("try_wait_until_time_index",
+             &Types::Frontend::try_wait_until_timeindex)
+        .def("wait_for_any_newer_than",
+             &Types::Frontend::wait_for_any_newer_than,
+             pybind11::arg("t"),
+             pybind11::arg("max_duration_s") =
+                 std::numeric_limits<double>::infinity(),
              pybind11::call_guard<pybind11::gil_scoped_release>())
+        .def(
+            "step",
+            [](typename Types::Frontend &frontend,
+               const typename Types::Action &desired_action) {
+                auto result = frontend.step(desired_action);
+                return std::make_tuple(
+                    result.timeindex, result.observation, result.status);
+            },
+            pybind11::call_guard<pybind11::gil_scoped_release>(),
+            "Append the action and return the tuple (time index, "
+            "observation, status) of the step after it is applied.")
         .def("get_current_time_index",
              &Types::Frontend::get_current_timeindex,
+             pybind11::call_guard<pybind11::gil_scoped_release>())
+        .def("get_observations_per_action",
+             &Types::Frontend::get_observations_per_action)
+        .def("get_observation_time_index",
+             &Types::Frontend::get_observation_timeindex)
+        .def("get_action_time_index", &Types::Frontend::get_action_timeindex)
+        .def("get_backend_generation",
+             &Types::Frontend::get_backend_generation)
+        .def("has_backend_error", &Types::Frontend::has_backend_error)
+        .def("is_backend_terminated", &Types::Frontend::is_backend_terminated)
+        // the dispatcher thread needs the GIL to run Python callbacks, so
+        // release it while (un)subscribing
+        .def("subscribe_observations",
+             &Types::Frontend::subscribe_observations,
+             pybind11::arg("callback"),
+             pybind11::call_guard<pybind11::gil_scoped_release>())
+        .def("unsubscribe_observations",
+             &Types::Frontend::unsubscribe_observations,
+             pybind11::arg("subscription_id"),
+             pybind11::call_guard<pybind11::gil_scoped_release>())
+        .def("get_observation_event_fd",
+             &Types::Frontend::get_observation_event_fd,
+             pybind11::call_guard<pybind11::gil_scoped_release>());
+
+    pybind11::class_<typename Types::Observer>(m, "ObserverFrontend")
+        .def(pybind11::init<std::string>(),
+             pybind11::arg("shared_memory_id_prefix"))
+        .def("get_current_time_index",
+             &Types::Observer::get_current_timeindex)
+        .def("get_oldest_time_index", &Types::Observer::get_oldest_timeindex)
+        .def("get_observation", &Types::Observer::get_observation)
+        .def("get_timestamp_ms", &Types::Observer::get_timestamp_ms)
+        .def("get_latest_observation",
+             &Types::Observer::get_latest_observation)
+        .def("get_latest_status", &Types::Observer::get_latest_status)
+        .def("wait_until_time_index",
+             &Types::Observer::wait_until_timeindex,
+             pybind11::arg("t"),
+             pybind11::arg("max_duration_s") =
+                 std::numeric_limits<double>::infinity(),
+             pybind11::arg("poll_interval_s") = 0.001,
              pybind11::call_guard<pybind11::gil_scoped_release>());
 
     pybind11::class_<typename Types::Logger>(m, "Logger")
         .def(pybind11::init<typename Types::BaseDataPtr, int>())
-        .def("start", &Types::Logger::start)
+        .def("start",
+             &Types::Logger::start,
+             pybind11::arg("filename"),
+             pybind11::arg("format") = RobotLogFormat::TEXT)
         .def("stop", &Types::Logger::stop);
 }
 
+/**
+ * \brief Create Python bindings for MonitoredRobotDriver<Driver>.
+ *
+ * Bindings for the driver itself (with std::shared_ptr as holder) must exist.
+ * The bindings for the timing statistics are in the py_generic module.
+ *
+ * \tparam Driver  The monitored robot driver.
+ * \param m  The second argument of the PYBIND11_MODULE macro.
+ * \param name  Name of the Python class.
+ */
+template <typename Driver>
+void create_monitored_driver_python_bindings(
+    pybind11::module &m, const std::string &name = "MonitoredDriver")
+{
+    typedef MonitoredRobotDriver<Driver> MonitoredDriver;
+
+    pybind11::class_<MonitoredDriver, std::shared_ptr<MonitoredDriver>>(
+        m, name.c_str())
+        .def(pybind11::init<std::shared_ptr<Driver>, double, double>(),
+             pybind11::arg("robot_driver"),
+             pybind11::arg("max_action_duration_s"),
+             pybind11::arg("max_inter_action_duration_s"))
+        .def(pybind11::init([](std::shared_ptr<Driver> robot_driver,
+                               double max_action_duration_s,
+                               double max_inter_action_duration_s,
+                               const TimingThresholds &thresholds) {
+                 return std::make_shared<MonitoredDriver>(
+                     robot_driver,
+                     max_action_duration_s,
+                     max_inter_action_duration_s,
+                     nullptr,
+                     thresholds);
+             }),
+             pybind11::arg("robot_driver"),
+             pybind11::arg("max_action_duration_s"),
+             pybind11::arg("max_inter_action_duration_s"),
+             pybind11::arg("thresholds"))
+        .def("get_error", &MonitoredDriver::get_error)
+        .def("get_timing_statistics", &MonitoredDriver::get_timing_statistics);
+}
+
 }  // namespace robot_interfaces
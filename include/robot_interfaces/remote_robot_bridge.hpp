@@ -0,0 +1,311 @@
+/**
+ * @file
+ * @brief Server side of RemoteRobotData.
+ * @copyright 2020, Max Planck Gesellschaft. All rights reserved.
+ * @license BSD 3-clause
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "remote_robot_data.hpp"
+#include "robot_data.hpp"
+#include "robot_frontend.hpp"
+#include "socket_transport.hpp"
+
+namespace robot_interfaces
+{
+/**
+ * @brief Makes robot data accessible to a RemoteRobotData over TCP.
+ *
+ * Typically attached to the MultiProcessRobotData of a backend.  Listens on
+ * the given port and, once a RemoteRobotData connects, forwards new
+ * observations, applied actions and status to it and appends the desired
+ * actions it receives to the robot data.
+ *
+ * Only one client is served during the lifetime of the bridge, as the time
+ * indices of the desired actions of a second client would not match the
+ * ones of the robot data.  The client has to connect before the first action
+ * is appended.
+ *
+ * @tparam Action
+ * @tparam Observation
+ */
+template <typename Action, typename Observation>
+class RemoteRobotBridge
+{
+public:
+    typedef time_series::Index TimeIndex;
+
+    /**
+     * @param robot_data  The robot data that is made accessible.
+     * @param port  Port to listen on.  If zero, a free port is chosen, see
+     *     get_port().
+     * @param loopback_only  If true, only clients on the same machine can
+     *     connect.  There is no authentication, so only disable this in
+     *     trusted networks.
+     * @param poll_interval_s  The bridge is woken up by new observations.  To
+     *     also forward applied actions and status that are appended after
+     *     the observation of a step, it further checks the robot data at
+     *     this interval.
+     * @throws std::runtime_error if the port cannot be opened.
+     */
+    RemoteRobotBridge(
+        std::shared_ptr<RobotData<Action, Observation>> robot_data,
+        const uint16_t port,
+        const bool loopback_only = true,
+        const double poll_interval_s = 0.001)
+        : robot_data_(robot_data),
+          frontend_(robot_data),
+          listener_(port, loopback_only),
+          poll_interval_s_(poll_interval_s),
+          is_shutdown_requested_(false),
+          is_connected_(false)
+    {
+        thread_ = std::thread(&RemoteRobotBridge::serve, this);
+    }
+
+    ~RemoteRobotBridge()
+    {
+        is_shutdown_requested_ = true;
+        listener_.shutdown();
+        {
+            std::lock_guard<std::mutex> lock(connection_mutex_);
+            if (connection_)
+            {
+                connection_->shutdown();
+            }
+        }
+        robot_data_->control_block->notify();
+        thread_.join();
+    }
+
+    //! @brief Port on which the bridge listens.
+    uint16_t get_port() const
+    {
+        return listener_.get_port();
+    }
+
+    //! @brief Check if a client is connected.
+    bool is_connected() const
+    {
+        return is_connected_;
+    }
+
+    /**
+     * @brief Get statistics of the connection, e.g. latency and loss.
+     *
+     * All zero if no client has connected yet.
+     */
+    TransportStatistics get_transport_statistics() const
+    {
+        std::lock_guard<std::mutex> lock(connection_mutex_);
+        return connection_ ? connection_->get_statistics()
+                           : TransportStatistics();
+    }
+
+private:
+    std::shared_ptr<RobotData<Action, Observation>> robot_data_;
+    RobotFrontend<Action, Observation> frontend_;
+    internal::TcpListener listener_;
+    const double poll_interval_s_;
+
+    std::atomic<bool> is_shutdown_requested_;
+    std::atomic<bool> is_connected_;
+
+    mutable std::mutex connection_mutex_;
+    std::shared_ptr<internal::SocketConnection> connection_;
+    std::thread thread_;
+
+    //! @brief Wait for the client and serve it.
+    void serve()
+    {
+        std::shared_ptr<internal::SocketConnection> connection =
+            listener_.accept();
+        if (!connection)
+        {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(connection_mutex_);
+            connection_ = connection;
+        }
+        if (is_shutdown_requested_ || !send_hello(*connection))
+        {
+            return;
+        }
+
+        is_connected_ = true;
+        std::thread sender_thread(
+            &RemoteRobotBridge::send_loop, this, std::ref(*connection));
+
+        try
+        {
+            receive_loop(*connection);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Error in connection of robot bridge: " << e.what()
+                      << std::endl;
+        }
+
+        is_connected_ = false;
+        connection->shutdown();
+        robot_data_->control_block->notify();
+        sender_thread.join();
+    }
+
+    /**
+     * @brief Send the handshake.
+     *
+     * @return False if the connection is refused.
+     */
+    bool send_hello(internal::SocketConnection &connection)
+    {
+        internal::RemoteRobotHello hello;
+        hello.observations_per_action =
+            robot_data_->get_observations_per_action();
+        hello.generation = robot_data_->control_block->generation;
+        if (robot_data_->desired_action->newest_timeindex(false) !=
+                time_series::EMPTY ||
+            robot_data_->observation->oldest_timeindex(false) > 0)
+        {
+            hello.error_message =
+                "The robot has already received actions.  Remote robot data "
+                "has to be connected before the first action.";
+        }
+
+        internal::ElementBatch batch;
+        batch.add(0, hello);
+        connection.send(internal::MessageType::HELLO,
+                        batch.get_data(),
+                        batch.get_number_of_elements());
+
+        if (!hello.error_message.empty())
+        {
+            std::cerr << "Robot bridge refused connection: "
+                      << hello.error_message << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    //! @brief Forward new elements of the robot data to the client.
+    void send_loop(internal::SocketConnection &connection)
+    {
+        ControlBlock &control_block = *robot_data_->control_block;
+        internal::ElementBatch batch;
+        TimeIndex next_status = 0, next_applied_action = 0,
+                  next_observation = 0;
+
+        try
+        {
+            while (!is_shutdown_requested_ && is_connected_)
+            {
+                control_block.wait(
+                    [&]() {
+                        return control_block.newest_observation.load() >=
+                                   next_observation ||
+                               is_shutdown_requested_ || !is_connected_;
+                    },
+                    poll_interval_s_);
+
+                // Status and applied action of a step are appended before the
+                // observation of the next step, so forward them first.
+                if (!forward(connection,
+                             batch,
+                             internal::MessageType::STATUS,
+                             *robot_data_->status,
+                             next_status) ||
+                    !forward(connection,
+                             batch,
+                             internal::MessageType::APPLIED_ACTION,
+                             *robot_data_->applied_action,
+                             next_applied_action) ||
+                    !forward(connection,
+                             batch,
+                             internal::MessageType::OBSERVATION,
+                             *robot_data_->observation,
+                             next_observation))
+                {
+                    break;
+                }
+            }
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Error in connection of robot bridge: " << e.what()
+                      << std::endl;
+            connection.shutdown();
+        }
+    }
+
+    /**
+     * @brief Send all elements of a time series starting at next_t.
+     *
+     * @return False if the connection is closed.
+     */
+    template <typename T>
+    bool forward(internal::SocketConnection &connection,
+                 internal::ElementBatch &batch,
+                 const internal::MessageType type,
+                 const time_series::TimeSeriesInterface<T> &time_series,
+                 TimeIndex &next_t)
+    {
+        const TimeIndex newest_t = time_series.newest_timeindex(false);
+        if (newest_t < next_t)
+        {
+            return true;
+        }
+        if (time_series.oldest_timeindex(false) > next_t)
+        {
+            throw std::runtime_error(
+                "Element " + std::to_string(next_t) +
+                " was dropped from the history before it was sent.");
+        }
+
+        // if the batch is full, the rest is sent in the next iteration
+        batch.clear();
+        for (; next_t <= newest_t && !batch.is_full(); next_t++)
+        {
+            batch.add(next_t, time_series[next_t]);
+        }
+        return connection.send(
+            type, batch.get_data(), batch.get_number_of_elements());
+    }
+
+    //! @brief Append the desired actions received from the client.
+    void receive_loop(internal::SocketConnection &connection)
+    {
+        internal::Message message;
+        while (connection.receive(message))
+        {
+            if (message.type != internal::MessageType::DESIRED_ACTION)
+            {
+                continue;
+            }
+            internal::for_each_element<Action>(
+                message, [&](const int64_t t, const Action &action) {
+                    const TimeIndex appended_t =
+                        frontend_.append_desired_action(action);
+                    if (appended_t != t)
+                    {
+                        throw std::runtime_error(
+                            "Desired action " + std::to_string(t) +
+                            " of the client got index " +
+                            std::to_string(appended_t) +
+                            ".  Is there another source of actions?");
+                    }
+                });
+        }
+    }
+};
+
+}  // namespace robot_interfaces
@@ -0,0 +1,288 @@
+/**
+ * @file
+ * @brief RobotData that mirrors the data of a robot on another machine.
+ * @copyright 2020, Max Planck Gesellschaft. All rights reserved.
+ * @license BSD 3-clause
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <time_series/time_series.hpp>
+
+#include "robot_data.hpp"
+#include "socket_transport.hpp"
+#include "status.hpp"
+
+namespace robot_interfaces
+{
+namespace internal
+{
+//! @brief Content of the HELLO message of RemoteRobotBridge.
+struct RemoteRobotHello
+{
+    uint32_t observations_per_action = 1;
+    uint64_t generation = 0;
+    //! @brief If not empty, the bridge refuses the connection.
+    std::string error_message;
+
+    template <class Archive>
+    void serialize(Archive &archive)
+    {
+        archive(observations_per_action, generation, error_message);
+    }
+};
+
+/**
+ * @brief Append the elements of a message to a time series.
+ *
+ * @throws std::runtime_error if the time indices of the message do not
+ *     continue the time series.
+ */
+template <typename T>
+void append_elements(const Message &message,
+                     time_series::TimeSeriesInterface<T> &time_series)
+{
+    for_each_element<T>(message, [&](const int64_t t, const T &element) {
+        if (t != time_series.newest_timeindex(false) + 1)
+        {
+            throw std::runtime_error(
+                "Received element " + std::to_string(t) +
+                " does not continue the time series (newest is " +
+                std::to_string(time_series.newest_timeindex(false)) + ").");
+        }
+        time_series.append(element);
+    });
+}
+}  // namespace internal
+
+/**
+ * @brief RobotData that is connected to a robot on another machine.
+ *
+ * Connects to a RemoteRobotBridge, which is attached to the RobotData of the
+ * backend.  The time series are local copies: observations, applied actions
+ * and status are received from the bridge, desired actions appended here are
+ * sent to the bridge, which appends them to the robot data of the backend.
+ * So a RobotFrontend can be used with this like with any other RobotData.
+ *
+ * Elements are batched, i.e. all elements that are new when the sender wakes
+ * up are sent in one message, and serialized with the binary archive of
+ * cereal.  See get_transport_statistics() for the latency and loss of the
+ * connection.
+ *
+ * To keep the time indices of both sides in sync, the remote data has to be
+ * connected before the first action is sent to the robot and it must be the
+ * only source of desired actions.  Further, the following is not mirrored:
+ * - the step values for RobotFrontend::get_action_deadline(),
+ * - the ObserverBuffer and the ActionArbiter (both are unset).
+ *
+ * @copydoc RobotData
+ */
+template <typename Action, typename Observation>
+class RemoteRobotData : public RobotData<Action, Observation>
+{
+public:
+    typedef time_series::Index TimeIndex;
+
+    /**
+     * @brief Connect to a RemoteRobotBridge.
+     *
+     * @param host  Host name or address of the machine running the bridge.
+     * @param port  Port of the bridge.
+     * @param history_length  History length of the local time series.
+     * @throws std::runtime_error if the connection fails or is refused by the
+     *     bridge.
+     */
+    RemoteRobotData(const std::string &host,
+                    const uint16_t port,
+                    const size_t history_length = 1000)
+        : RemoteRobotData(internal::connect_tcp(host, port), history_length)
+    {
+    }
+
+    ~RemoteRobotData()
+    {
+        is_shutdown_requested_ = true;
+        connection_->shutdown();
+        this->control_block->notify();
+        sender_thread_.join();
+        receiver_thread_.join();
+    }
+
+    //! @brief Check if the connection to the bridge is still alive.
+    bool is_connected() const
+    {
+        return is_connected_;
+    }
+
+    //! @brief Get statistics of the connection, e.g. latency and loss.
+    TransportStatistics get_transport_statistics() const
+    {
+        return connection_->get_statistics();
+    }
+
+private:
+    std::shared_ptr<internal::SocketConnection> connection_;
+    std::atomic<bool> is_shutdown_requested_;
+    std::atomic<bool> is_connected_;
+    std::thread sender_thread_;
+    std::thread receiver_thread_;
+
+    RemoteRobotData(std::shared_ptr<internal::SocketConnection> connection,
+                    const size_t history_length)
+        : RemoteRobotData(
+              connection, receive_hello(*connection), history_length)
+    {
+    }
+
+    RemoteRobotData(std::shared_ptr<internal::SocketConnection> connection,
+                    const internal::RemoteRobotHello &hello,
+                    const size_t history_length)
+        : RobotData<Action, Observation>(hello.observations_per_action),
+          connection_(connection),
+          is_shutdown_requested_(false),
+          is_connected_(true)
+    {
+        std::cout << "Using remote robot data." << std::endl;
+        this->desired_action =
+            std::make_shared<time_series::TimeSeries<Action>>(history_length);
+        this->applied_action =
+            std::make_shared<time_series::TimeSeries<Action>>(history_length);
+        this->observation =
+            std::make_shared<time_series::TimeSeries<Observation>>(
+                history_length * hello.observations_per_action);
+        this->status =
+            std::make_shared<time_series::TimeSeries<Status>>(history_length);
+        this->control_block = create_single_process_control_block();
+        this->control_block->generation = hello.generation;
+
+        sender_thread_ = std::thread(&RemoteRobotData::send_loop, this);
+        receiver_thread_ = std::thread(&RemoteRobotData::receive_loop, this);
+    }
+
+    static internal::RemoteRobotHello receive_hello(
+        internal::SocketConnection &connection)
+    {
+        internal::Message message;
+        if (!connection.receive(message) ||
+            message.type != internal::MessageType::HELLO)
+        {
+            throw std::runtime_error(
+                "Connection to robot bridge failed: no handshake.");
+        }
+
+        internal::RemoteRobotHello hello;
+        internal::for_each_element<internal::RemoteRobotHello>(
+            message,
+            [&](const int64_t, const internal::RemoteRobotHello &received) {
+                hello = received;
+            });
+        if (!hello.error_message.empty())
+        {
+            throw std::runtime_error("Robot bridge refused the connection: " +
+                                     hello.error_message);
+        }
+        return hello;
+    }
+
+    //! @brief Send new desired actions to the bridge.
+    void send_loop()
+    {
+        ControlBlock &control_block = *this->control_block;
+        internal::ElementBatch batch;
+        TimeIndex next_t = 0;
+
+        while (!is_shutdown_requested_ && is_connected_)
+        {
+            // the frontend notifies after appending an action
+            control_block.wait(
+                [&]() {
+                    return control_block.newest_desired_action.load() >=
+                               next_t ||
+                           is_shutdown_requested_ || !is_connected_;
+                },
+                0.1);
+
+            const TimeIndex newest_t =
+                this->desired_action->newest_timeindex(false);
+            if (newest_t < next_t)
+            {
+                continue;
+            }
+
+            // if the batch is full, the rest is sent in the next iteration
+            batch.clear();
+            for (; next_t <= newest_t && !batch.is_full(); next_t++)
+            {
+                batch.add(next_t, (*this->desired_action)[next_t]);
+            }
+            if (!connection_->send(internal::MessageType::DESIRED_ACTION,
+                                   batch.get_data(),
+                                   batch.get_number_of_elements()))
+            {
+                break;
+            }
+        }
+    }
+
+    //! @brief Append the data received from the bridge.
+    void receive_loop()
+    {
+        ControlBlock &control_block = *this->control_block;
+        internal::Message message;
+
+        try
+        {
+            while (connection_->receive(message))
+            {
+                switch (message.type)
+                {
+                    case internal::MessageType::STATUS:
+                        internal::append_elements(message, *this->status);
+                        if (this->status->newest_element().has_error())
+                        {
+                            control_block.error_generation =
+                                control_block.generation.load();
+                        }
+                        break;
+                    case internal::MessageType::APPLIED_ACTION:
+                        internal::append_elements(message,
+                                                  *this->applied_action);
+                        break;
+                    case internal::MessageType::OBSERVATION:
+                        internal::append_elements(message, *this->observation);
+                        publish_timeindex(
+                            control_block.newest_observation,
+                            this->observation->newest_timeindex(false));
+                        break;
+                    default:
+                        break;
+                }
+                control_block.notify();
+            }
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Error in connection to robot bridge: " << e.what()
+                      << std::endl;
+        }
+
+        if (!is_shutdown_requested_)
+        {
+            std::cerr << "Connection to robot bridge closed." << std::endl;
+        }
+        is_connected_ = false;
+        connection_->shutdown();
+        // without connection, no further data arrives from the backend
+        control_block.terminated_generation = control_block.generation.load();
+        control_block.notify();
+    }
+};
+
+}  // namespace robot_interfaces
@@ -10,8 +10,11 @@
 
 #include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <cmath>
+#include <condition_variable>
 #include <cstdint>
+#include <mutex>
 
 #include <pybind11/embed.h>
 
@@ -35,6 +38,11 @@ namespace robot_interfaces
  * writes it to RobotData, and it takes the desired_action from RobotData
  * and applies it on the RobotDriver.
  *
+ * By default the backend runs its loop in a real-time thread.  Alternatively,
+ * it can be driven explicitly by the caller with step() (see constructor
+ * argument `run_in_thread`), which is useful for deterministic simulations and
+ * tests.
+ *
  * @tparam Action
  * @tparam Observation
  */
@@ -52,26 +60,44 @@ public:
      *     and wait until the action is provided.
      * @param first_action_timeout  See RobotBackend::first_action_timeout_.
      * @param max_number_of_actions  See RobotBackend::max_number_of_actions_.
+     * @param run_in_thread  If true, the backend loop is executed in a
+     *     real-time thread that is started right away.  If false, no thread is
+     *     started and no signal handler is installed.  Instead the caller has
+     *     to drive the backend by calling step().  The first action timeout is
+     *     ignored in this case.
      */
     RobotBackend(std::shared_ptr<RobotDriver<Action, Observation>> robot_driver,
                  std::shared_ptr<RobotData<Action, Observation>> robot_data,
                  const bool real_time_mode = true,
                  const double first_action_timeout =
                      std::numeric_limits<double>::infinity(),
-                 const uint32_t max_number_of_actions = 0)
+                 const uint32_t max_number_of_actions = 0,
+                 const bool run_in_thread = true)
         : robot_driver_(robot_driver),
           robot_data_(robot_data),
           real_time_mode_(real_time_mode),
           first_action_timeout_(first_action_timeout),
           max_number_of_actions_(max_number_of_actions),
+          run_in_thread_(run_in_thread),
           is_shutdown_requested_(false),
-          max_action_repetitions_(0)
+          max_action_repetitions_(0),
+          max_step_duration_s_(std::numeric_limits<double>::infinity())
     {
-        signal_handler::SignalHandler::initialize();
+        // let frontends know that a (new) backend is running on the data
+        generation_ = ++robot_data_->control_block->generation;
 
         loop_is_running_ = true;
         thread_ = std::make_shared<real_time_tools::RealTimeThread>();
-        thread_->create_realtime_thread(&RobotBackend::loop, this);
+
+        if (run_in_thread_)
+        {
+            signal_handler::SignalHandler::initialize();
+            thread_->create_realtime_thread(&RobotBackend::loop, this);
+        }
+        else
+        {
+            initialize_loop();
+        }
     }
 
     virtual ~RobotBackend()
@@ -88,13 +114,11 @@ public:
             // run some Python code.
             pybind11::gil_scoped_release release;
 
-            request_shutdown();
-            thread_->join();
+            terminate();
         }
         else
         {
-            request_shutdown();
-            thread_->join();
+            terminate();
         }
     }
 
@@ -124,31 +148,122 @@ public:
         max_action_repetitions_ = max_action_repetitions;
     }
 
+    /**
+     * @brief Set the maximum duration of a step of the backend loop.
+     *
+     * Steps that take longer are counted as overruns in the timing information
+     * of the status (see StepTiming).  The robot is not stopped because of an
+     * overrun.  Default is infinity, i.e. no overruns are reported.
+     *
+     * Note that in non-real-time mode, the time the backend waits for the
+     * next action is part of the step duration.
+     *
+     * @param max_step_duration_s  Maximum step duration in seconds.
+     */
+    void set_max_step_duration(const double &max_step_duration_s)
+    {
+        max_step_duration_s_ = max_step_duration_s;
+    }
+
     void initialize()
     {
         robot_driver_->initialize();
     }
 
+    /**
+     * @brief Execute the backend loop step by step.
+     *
+     * Only allowed if the backend was created with `run_in_thread = false`.
+     * Each call does as much of the next step as possible without waiting:
+     * The observation and status of the step are recorded once and, if the
+     * desired action of the step is available (or repeated in real-time
+     * mode), it is applied.  If the action is not available yet, the call
+     * returns without applying anything and the next call continues the same
+     * step.
+     *
+     * Since the action is applied in the same call, step() takes as long as
+     * RobotDriver::apply_action().
+     *
+     * @return True if an action was applied, false if the action is not
+     *     available yet or the backend has terminated (see is_running()).
+     */
+    bool step()
+    {
+        if (run_in_thread_)
+        {
+            throw std::runtime_error(
+                "step() can only be used if the backend does not run in a "
+                "thread.");
+        }
+
+        if (!loop_is_running_)
+        {
+            return false;
+        }
+        if (has_shutdown_request())
+        {
+            finalize_loop();
+            return false;
+        }
+
+        // like the threaded loop, do not start before the first action
+        // arrived
+        if (t_ == start_t_ && !is_step_observed_ &&
+            !has_desired_action(start_t_))
+        {
+            return false;
+        }
+
+        if (!is_step_observed_ && !observe())
+        {
+            finalize_loop();
+            return false;
+        }
+
+        if (!has_desired_action(t_))
+        {
+            return false;
+        }
+        act();
+
+        return true;
+    }
+
+    /**
+     * @brief Check if the backend loop is still running.
+     *
+     * Returns false once the loop is terminated because of a shutdown request
+     * or an error.
+     */
+    bool is_running() const
+    {
+        return loop_is_running_;
+    }
+
     /**
      * @brief Request shutdown of the backend loop.
      *
-     * The loop may take some time to actually terminate after calling this
-     * function. Use wait_until_terminated() to ensure it has really terminated.
+     * A backend loop that is waiting for the next action is woken up right
+     * away, otherwise the request is noticed at the beginning of the next
+     * step.  Use wait_until_terminated() to ensure it has really terminated.
      */
     void request_shutdown()
     {
         is_shutdown_requested_ = true;
+        robot_data_->control_block->notify();
     }
 
     /**
      * @brief Wait until the backend loop terminates.
+     *
+     * If the backend does not run in a thread, this returns right away if the
+     * loop is terminated and blocks forever otherwise.
      */
     void wait_until_terminated() const
     {
-        while (loop_is_running_)
-        {
-            real_time_tools::Timer::sleep_microseconds(100000);
-        }
+        std::unique_lock<std::mutex> lock(termination_mutex_);
+        termination_condition_.wait(lock,
+                                    [this]() { return !loop_is_running_; });
     }
 
 private:
@@ -187,6 +302,9 @@ private:
      */
     const uint32_t max_number_of_actions_;
 
+    //! @brief Whether the loop is run in a thread or driven by step().
+    const bool run_in_thread_;
+
     /**
      * @brief Set to true when shutdown is requested.
      *
@@ -198,20 +316,216 @@ private:
     //! @brief Indicates if the background loop is still running.
     std::atomic<bool> loop_is_running_;
 
+    //! @brief Used to notify wait_until_terminated() when the loop terminates.
+    mutable std::mutex termination_mutex_;
+    mutable std::condition_variable termination_condition_;
+
     /**
      * @brief Number of times the previous action is repeated if no new one
      *        is provided.
      */
     uint32_t max_action_repetitions_;
 
+    //! @brief Steps taking longer than this are reported as overrun.
+    std::atomic<double> max_step_duration_s_;
+
     real_time_tools::CheckpointTimer<6, false> timer_;
 
     std::shared_ptr<real_time_tools::RealTimeThread> thread_;
 
+    //! @brief Value of ControlBlock::generation set by this backend.
+    uint64_t generation_;
+
+    // state of the loop
+    // ------------------------------------------------------------
+    uint32_t observations_per_action_;
+    //! @brief Action index at which the loop started.
+    long int start_t_;
+    //! @brief Action index of the current step.
+    long int t_;
+    //! @brief Whether observation and status of the current step are recorded.
+    bool is_step_observed_;
+
+    // timing of the previous step, reported in the status
+    StepTiming step_timing_;
+    double step_start_time_;
+    double get_observation_duration_s_;
+    double apply_action_duration_s_;
+
+    // published in the control block for predicting action deadlines
+    std::chrono::steady_clock::time_point step_start_steady_time_;
+    //! @brief Moving average of the step duration (0 if unknown).
+    double step_period_ns_;
+
+    //! @brief Stop the loop and wait until it is terminated.
+    void terminate()
+    {
+        request_shutdown();
+        if (run_in_thread_)
+        {
+            thread_->join();
+        }
+        else if (loop_is_running_)
+        {
+            finalize_loop();
+        }
+    }
+
     bool has_shutdown_request() const
     {
         return is_shutdown_requested_ ||
-               signal_handler::SignalHandler::has_received_sigint();
+               (run_in_thread_ &&
+                signal_handler::SignalHandler::has_received_sigint());
+    }
+
+    //! @brief Append an observation and publish it to observers.
+    void append_observation(const long int t, const Observation &observation)
+    {
+        robot_data_->observation->append(observation);
+        if (robot_data_->observer_buffer)
+        {
+            robot_data_->observer_buffer->publish_observation(
+                t, real_time_tools::Timer::get_current_time_ms(), observation);
+        }
+    }
+
+    //! @brief Append a status and publish it to observers.
+    void append_status(const Status &status)
+    {
+        robot_data_->status->append(status);
+        if (robot_data_->observer_buffer)
+        {
+            robot_data_->observer_buffer->publish_status(
+                robot_data_->status->newest_timeindex(false),
+                real_time_tools::Timer::get_current_time_ms(),
+                status);
+        }
+    }
+
+    /**
+     * @brief Append a status with error and flag the error in the control
+     *     block, so frontends notice it.
+     */
+    void append_error_status(const Status &status)
+    {
+        append_status(status);
+        robot_data_->control_block->error_generation = generation_;
+    }
+
+    /**
+     * @brief Append the action selected by the action arbiter (if any).
+     *
+     * @param t  Time index the action is needed for.
+     * @param only_if_new  See ActionArbiter::select().
+     * @return True if an action was appended.
+     */
+    bool append_arbitrated_action(const long int t, const bool only_if_new)
+    {
+        Action action;
+        if (!robot_data_->action_arbiter ||
+            !robot_data_->action_arbiter->select(action, only_if_new))
+        {
+            return false;
+        }
+
+        robot_data_->desired_action->append(action);
+        publish_timeindex(robot_data_->control_block->newest_desired_action, t);
+        return true;
+    }
+
+    /**
+     * @brief Check if the desired action with index t is available.
+     *
+     * If it is not, take a new action from the action arbiter if there is
+     * one.
+     */
+    bool has_desired_action(const long int t)
+    {
+        return contains_timeindex(*robot_data_->desired_action, t) ||
+               append_arbitrated_action(t, true);
+    }
+
+    //! @brief Check if the given time series already contains index t.
+    template <typename T>
+    static bool contains_timeindex(
+        const time_series::TimeSeriesInterface<T> &series, const long int t)
+    {
+        return series.length() > 0 && series.newest_timeindex() >= t;
+    }
+
+    /**
+     * @brief Wait for the desired action with index t.
+     *
+     * Depending on the wait strategy of the robot data, spin for a while
+     * first, then sleep on the control block until the frontend publishes the
+     * action or shutdown is requested.
+     *
+     * Times out after 0.1 s anyway, as a SIGINT or actions that are appended to
+     * the time series directly (i.e. not via RobotFrontend) do not wake up the
+     * backend.
+     *
+     * New actions submitted to the action arbiter also end the wait, see
+     * has_desired_action().
+     *
+     * @return True if the action is available, false on timeout or shutdown
+     *     request.
+     */
+    bool wait_for_desired_action(const long int t)
+    {
+        ControlBlock &control_block = *robot_data_->control_block;
+        const ActionArbiter<Action> *arbiter =
+            robot_data_->action_arbiter.get();
+        const uint64_t num_submissions =
+            arbiter ? arbiter->get_number_of_submissions() : 0;
+        auto is_done = [&]() {
+            return control_block.newest_desired_action.load() >= t ||
+                   (arbiter &&
+                    arbiter->get_number_of_submissions() != num_submissions) ||
+                   has_shutdown_request();
+        };
+
+        if (robot_data_->wait_strategy.mode ==
+            WaitStrategy::Mode::SPIN_THEN_BLOCK)
+        {
+            spin_until(is_done, robot_data_->wait_strategy.max_spin_duration_s);
+        }
+        control_block.wait(is_done, 0.1);
+
+        return has_desired_action(t);
+    }
+
+    /**
+     * @brief Update the step timing with the measurements of a completed step.
+     */
+    void update_step_timing(const double step_duration_s,
+                            const double get_observation_duration_s,
+                            const double apply_action_duration_s,
+                            StepTiming &timing) const
+    {
+        timing.step_duration_s = step_duration_s;
+        timing.get_observation_duration_s = get_observation_duration_s;
+        timing.apply_action_duration_s = apply_action_duration_s;
+        timing.max_step_duration_s =
+            std::max(timing.max_step_duration_s, step_duration_s);
+        timing.overrun = step_duration_s > max_step_duration_s_;
+        if (timing.overrun)
+        {
+            timing.overrun_count++;
+        }
+    }
+
+    //! @brief Update the moving average of the step duration.
+    void update_step_period(const std::chrono::steady_clock::duration &duration)
+    {
+        // weight of the newest step
+        constexpr double SMOOTHING = 0.1;
+
+        const double duration_ns =
+            std::chrono::duration<double, std::nano>(duration).count();
+        step_period_ns_ = step_period_ns_ == 0
+                              ? duration_ns
+                              : (1 - SMOOTHING) * step_period_ns_ +
+                                    SMOOTHING * duration_ns;
     }
 
     // control loop
@@ -228,16 +542,21 @@ private:
      * Iterate over robot_data_.desired_action and apply these actions to
      * the robot, and read the applied_action and the observation from the
      * robot and append them to the corresponding timeseries in robot_data_.
+     *
+     * If the robot data is configured to record more than one observation per
+     * action, each action is held (i.e. applied again) for the corresponding
+     * number of steps and the observation of each of these steps is recorded.
      */
     void loop()
     {
+        initialize_loop();
+
         const double start_time =
             real_time_tools::Timer::get_current_time_sec();
 
         // wait until first desired_action was received
         // ----------------------------
-        while (!has_shutdown_request() &&
-               !robot_data_->desired_action->wait_for_timeindex(0, 0.1))
+        while (!has_shutdown_request() && !wait_for_desired_action(start_t_))
         {
             const double now = real_time_tools::Timer::get_current_time_sec();
             if (now - start_time > first_action_timeout_)
@@ -246,7 +565,7 @@ private:
                 status.set_error(Status::ErrorStatus::BACKEND_ERROR,
                                  "First action was not provided in time");
 
-                robot_data_->status->append(status);
+                append_error_status(status);
 
                 std::cerr << "Error: " << status.error_message
                           << "\nRobot is shut down." << std::endl;
@@ -256,102 +575,298 @@ private:
             }
         }
 
-        for (long int t = 0; !has_shutdown_request(); t++)
+        while (!has_shutdown_request())
         {
-            // TODO: figure out latency stuff!!
-
-            Status status;
-
-            if (max_number_of_actions_ > 0 && t >= max_number_of_actions_)
+            if (!observe())
             {
-                // TODO this is not really an error
-                status.set_error(Status::ErrorStatus::BACKEND_ERROR,
-                                 "Maximum number of actions reached.");
+                break;
             }
 
-            timer_.start();
-
-            // get latest observation from robot and append it to robot_data_
-            Observation observation = robot_driver_->get_latest_observation();
-            timer_.checkpoint("get observation");
-
-            robot_data_->observation->append(observation);
-            // TODO: for some reason this sometimes takes more than 2 ms
-            // i think this may be due to a non-realtime thread blocking the
-            // timeseries. this is in fact an issue, we might have to
-            // duplicate all the timeseries and have a realtime thread
-            // writing back and forth
-            timer_.checkpoint("append observation");
-
-            // If real time mode is enabled the next action needs to be provided
-            // in time.  If this is not the case, optionally repeat the previous
-            // action or raise an error.
-            if (real_time_mode_ &&
-                robot_data_->desired_action->newest_timeindex() < t)
+            // early exit if destructor has been called
+            while (!has_shutdown_request() && !wait_for_desired_action(t_))
             {
-                uint32_t action_repetitions =
-                    robot_data_->status->newest_element().action_repetitions;
-
-                if (action_repetitions < max_action_repetitions_)
-                {
-                    robot_data_->desired_action->append(
-                        robot_data_->desired_action->newest_element());
-                    status.action_repetitions = action_repetitions + 1;
-                }
-                else
-                {
-                    // No action provided and number of allowed repetitions
-                    // of the previous action is exceeded --> Error
-                    status.set_error(Status::ErrorStatus::BACKEND_ERROR,
-                                     "Next action was not provided in time");
-                }
             }
-
-            std::string driver_error_msg = robot_driver_->get_error();
-            if (!driver_error_msg.empty())
+            if (has_shutdown_request())
             {
-                status.set_error(Status::ErrorStatus::DRIVER_ERROR,
-                                 driver_error_msg);
+                break;
             }
 
-            robot_data_->status->append(status);
+            act();
+        }
+
+        finalize_loop();
+    }
+
+    /**
+     * @brief Prepare the state of the loop.
+     *
+     * If the robot data already contains the history of a previous backend
+     * (see MultiProcessRobotData with `reattach`), the loop resumes after the
+     * last action that was applied by the previous backend.
+     *
+     * This does not use the driver, as it is called before the driver is
+     * initialized.
+     */
+    void initialize_loop()
+    {
+        observations_per_action_ = robot_data_->get_observations_per_action();
+
+        start_t_ = robot_data_->applied_action->length() == 0
+                       ? 0
+                       : robot_data_->applied_action->newest_timeindex() + 1;
+        t_ = start_t_;
+        is_step_observed_ = false;
+
+        step_timing_ = StepTiming();
+        step_start_time_ = std::numeric_limits<double>::quiet_NaN();
+        step_period_ns_ = 0;
+        get_observation_duration_s_ = 0;
+        apply_action_duration_s_ = 0;
+    }
+
+    /**
+     * @brief Fill in the observations that are missing because the previous
+     *     backend was interrupted while holding an action.
+     *
+     * Keeps observation and action indices aligned.  Uses the driver, so it
+     * must not be called before the first action arrived (which implies
+     * that the driver is initialized).
+     */
+    void fill_missing_observations()
+    {
+        while (!contains_timeindex(*robot_data_->observation,
+                                   start_t_ * observations_per_action_ - 1))
+        {
+            robot_data_->observation->append(
+                robot_driver_->get_latest_observation());
+        }
+        publish_timeindex(robot_data_->control_block->newest_observation,
+                          start_t_ * observations_per_action_ - 1);
+    }
+
+    /**
+     * @brief First part of a step: record observation and status.
+     *
+     * In real-time mode, the previous action is repeated here if the next one
+     * is not provided in time.
+     *
+     * @return False if there is an error and the loop has to stop.
+     */
+    bool observe()
+    {
+        const long int t = t_;
+
+        // TODO: figure out latency stuff!!
+
+        // The previous backend may have been interrupted after recording
+        // the observation and status of its last step.  Do not record them
+        // a second time in this case.
+        const bool is_resumed_step = start_t_ > 0 && t == start_t_;
+        if (is_resumed_step)
+        {
+            fill_missing_observations();
+        }
+
+        const double now = real_time_tools::Timer::get_current_time_sec();
+        const std::chrono::steady_clock::time_point steady_now =
+            std::chrono::steady_clock::now();
+        if (t > start_t_)
+        {
+            update_step_timing(now - step_start_time_,
+                               get_observation_duration_s_,
+                               apply_action_duration_s_,
+                               step_timing_);
+            update_step_period(steady_now - step_start_steady_time_);
+        }
+        step_start_time_ = now;
+        step_start_steady_time_ = steady_now;
 
-            // if there is an error, shut robot down and stop loop
-            if (status.error_status != Status::ErrorStatus::NO_ERROR)
+        Status status;
+        status.timing = step_timing_;
+
+        if (max_number_of_actions_ > 0 &&
+            t - start_t_ >= max_number_of_actions_)
+        {
+            // TODO this is not really an error
+            status.set_error(Status::ErrorStatus::BACKEND_ERROR,
+                             "Maximum number of actions reached.");
+        }
+
+        timer_.start();
+
+        // get latest observation from robot and append it to robot_data_
+        Observation observation = robot_driver_->get_latest_observation();
+        get_observation_duration_s_ =
+            real_time_tools::Timer::get_current_time_sec() - step_start_time_;
+        timer_.checkpoint("get observation");
+
+        if (!is_resumed_step ||
+            !contains_timeindex(*robot_data_->observation,
+                                t * observations_per_action_))
+        {
+            append_observation(t * observations_per_action_, observation);
+        }
+        publish_timeindex(robot_data_->control_block->newest_observation,
+                          t * observations_per_action_);
+        robot_data_->control_block->notify();
+        // TODO: for some reason this sometimes takes more than 2 ms
+        // i think this may be due to a non-realtime thread blocking the
+        // timeseries. this is in fact an issue, we might have to
+        // duplicate all the timeseries and have a realtime thread
+        // writing back and forth
+        timer_.checkpoint("append observation");
+
+        // If real time mode is enabled the next action needs to be provided
+        // in time.  If this is not the case, optionally repeat the previous
+        // action or raise an error.
+        if (real_time_mode_ &&
+            robot_data_->desired_action->newest_timeindex() < t &&
+            !append_arbitrated_action(t, false))
+        {
+            uint32_t action_repetitions =
+                robot_data_->status->newest_element().action_repetitions;
+
+            if (action_repetitions < max_action_repetitions_)
             {
-                std::cerr << "Error: " << status.error_message
-                          << "\nRobot is shut down." << std::endl;
-                break;
+                robot_data_->desired_action->append(
+                    robot_data_->desired_action->newest_element());
+                publish_timeindex(
+                    robot_data_->control_block->newest_desired_action, t);
+                status.action_repetitions = action_repetitions + 1;
             }
-            timer_.checkpoint("status");
+            else
+            {
+                // No action provided and number of allowed repetitions
+                // of the previous action is exceeded --> Error
+                status.set_error(Status::ErrorStatus::BACKEND_ERROR,
+                                 "Next action was not provided in time");
+            }
+        }
 
-            // early exit if destructor has been called
-            while (!has_shutdown_request() &&
-                   !robot_data_->desired_action->wait_for_timeindex(t, 0.1))
+        robot_data_->control_block->publish_step(
+            t,
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                steady_now.time_since_epoch())
+                .count(),
+            static_cast<int64_t>(step_period_ns_),
+            status.action_repetitions,
+            real_time_mode_ ? static_cast<int64_t>(max_action_repetitions_)
+                            : -1);
+
+        std::string driver_error_msg = robot_driver_->get_error();
+        if (!driver_error_msg.empty())
+        {
+            status.set_error(Status::ErrorStatus::DRIVER_ERROR,
+                             driver_error_msg);
+        }
+
+        if (!is_resumed_step || !contains_timeindex(*robot_data_->status, t))
+        {
+            if (status.has_error())
             {
+                append_error_status(status);
             }
-            if (has_shutdown_request())
+            else
             {
-                break;
+                append_status(status);
             }
+        }
+        is_step_observed_ = true;
 
-            Action desired_action = (*robot_data_->desired_action)[t];
-            timer_.checkpoint("get action");
+        // if there is an error, shut robot down and stop loop
+        if (status.error_status != Status::ErrorStatus::NO_ERROR)
+        {
+            std::cerr << "Error: " << status.error_message
+                      << "\nRobot is shut down." << std::endl;
+            return false;
+        }
+        timer_.checkpoint("status");
 
-            Action applied_action = robot_driver_->apply_action(desired_action);
-            timer_.checkpoint("apply action");
+        return true;
+    }
 
-            robot_data_->applied_action->append(applied_action);
-            timer_.checkpoint("append applied action");
+    /**
+     * @brief Second part of a step: apply the desired action.
+     *
+     * The desired action of the current step has to be available.  Afterwards
+     * the loop proceeds to the next step.
+     *
+     * In multi-rate mode the action is applied again for each of the held
+     * sub-steps.  Only the result of the first application is recorded as
+     * applied action.  If the driver reports an error during the held
+     * sub-steps, an error status is appended for the next step (without
+     * observation) and the loop is shut down.
+     */
+    void act()
+    {
+        const long int t = t_;
 
-            if (t % 5000 == 0 && t > 0)
+        Action desired_action = (*robot_data_->desired_action)[t];
+        timer_.checkpoint("get action");
+
+        const double apply_action_start_time =
+            real_time_tools::Timer::get_current_time_sec();
+        Action applied_action = robot_driver_->apply_action(desired_action);
+        apply_action_duration_s_ =
+            real_time_tools::Timer::get_current_time_sec() -
+            apply_action_start_time;
+        timer_.checkpoint("apply action");
+
+        robot_data_->applied_action->append(applied_action);
+        timer_.checkpoint("append applied action");
+
+        // in multi-rate mode keep recording observations at the full rate
+        // while holding the action until the next one is due
+        for (uint32_t i = 1;
+             i < observations_per_action_ && !has_shutdown_request();
+             i++)
+        {
+            append_observation(t * observations_per_action_ + i,
+                               robot_driver_->get_latest_observation());
+            publish_timeindex(robot_data_->control_block->newest_observation,
+                              t * observations_per_action_ + i);
+            robot_data_->control_block->notify();
+            robot_driver_->apply_action(desired_action);
+
+            std::string driver_error_msg = robot_driver_->get_error();
+            if (!driver_error_msg.empty())
             {
-                timer_.print_statistics();
+                Status status;
+                status.set_error(Status::ErrorStatus::DRIVER_ERROR,
+                                 driver_error_msg);
+                append_error_status(status);
+
+                std::cerr << "Error: " << status.error_message
+                          << "\nRobot is shut down." << std::endl;
+
+                request_shutdown();
+                break;
             }
         }
 
+        if (t % 5000 == 0 && t > 0)
+        {
+            timer_.print_statistics();
+        }
+
+        t_++;
+        is_step_observed_ = false;
+    }
+
+    //! @brief Shut down the robot and mark the loop as terminated.
+    void finalize_loop()
+    {
+        // let waiting frontends know that no further steps will follow
+        robot_data_->control_block->terminated_generation = generation_;
+        robot_data_->control_block->notify();
+
         robot_driver_->shutdown();
-        loop_is_running_ = false;
+
+        {
+            std::lock_guard<std::mutex> lock(termination_mutex_);
+            loop_is_running_ = false;
+        }
+        termination_condition_.notify_all();
     }
 };
 
@@ -9,14 +9,20 @@
 
 #pragma once
 
+#include <cstdint>
 #include <iostream>
 #include <memory>
+#include <stdexcept>
 #include <string>
 
 #include <time_series/multiprocess_time_series.hpp>
 #include <time_series/time_series.hpp>
 
+#include "action_arbiter.hpp"
+#include "control_block.hpp"
+#include "observer_buffer.hpp"
 #include "status.hpp"
+#include "wait_strategy.hpp"
 
 namespace robot_interfaces
 {
@@ -59,10 +65,58 @@ public:
     std::shared_ptr<time_series::TimeSeriesInterface<Observation>> observation;
     //! @brief Time series of status messages.
     std::shared_ptr<time_series::TimeSeriesInterface<Status>> status;
+    //! @brief State of the backend that is shared with all frontends.
+    std::shared_ptr<ControlBlock> control_block;
+    /**
+     * @brief Lock-free copy of the newest observations and status.
+     *
+     * Written by the backend in addition to the time series if set, to be
+     * read by ObserverFrontend.  Only set by the master instance of
+     * MultiProcessRobotData.
+     */
+    std::shared_ptr<ObserverBuffer<Observation>> observer_buffer;
+    /**
+     * @brief Arbitration between the actions of several clients.
+     *
+     * See ActionArbiter and RobotFrontend::create_action_client().  May be
+     * unset for non-master instances of MultiProcessRobotData.
+     */
+    std::shared_ptr<ActionArbiter<Action>> action_arbiter;
+
+    /**
+     * @brief How backend and frontends using this instance wait for new data.
+     *
+     * Blocking by default.  This is not shared between processes, so each
+     * process can choose its own strategy.
+     */
+    WaitStrategy wait_strategy;
+
+    /**
+     * @brief Number of observations that are recorded per action.
+     *
+     * Is 1 for robots that run observations and actions at the same rate.
+     * Otherwise each action is applied once per observation, but only the
+     * result of the first application is recorded in `applied_action`.
+     */
+    uint32_t get_observations_per_action() const
+    {
+        return observations_per_action_;
+    }
 
 protected:
     // make constructor protected to prevent instantiation of the base class
-    RobotData(){};
+    RobotData(uint32_t observations_per_action = 1)
+        : observations_per_action_(observations_per_action)
+    {
+        if (observations_per_action_ < 1)
+        {
+            throw std::invalid_argument(
+                "observations_per_action must be at least 1.");
+        }
+    }
+
+private:
+    uint32_t observations_per_action_;
 };
 
 /**
@@ -82,9 +136,16 @@ public:
     /**
      * @brief Construct the time series for the robot data.
      *
-     * @param history_length History length of the time series.
+     * @param history_length History length of the time series.  The
+     *     history of the observation time series is scaled with
+     *     observations_per_action, so that it covers the same time span as the
+     *     others.
+     * @param observations_per_action Number of observations recorded per
+     *     action.  See RobotData::get_observations_per_action().
      */
-    SingleProcessRobotData(size_t history_length = 1000)
+    SingleProcessRobotData(size_t history_length = 1000,
+                           uint32_t observations_per_action = 1)
+        : RobotData<Action, Observation>(observations_per_action)
     {
         std::cout << "Using single process time series." << std::endl;
         this->desired_action =
@@ -93,9 +154,11 @@ public:
             std::make_shared<time_series::TimeSeries<Action>>(history_length);
         this->observation =
             std::make_shared<time_series::TimeSeries<Observation>>(
-                history_length);
+                history_length * observations_per_action);
         this->status =
             std::make_shared<time_series::TimeSeries<Status>>(history_length);
+        this->control_block = create_single_process_control_block();
+        this->action_arbiter = std::make_shared<ActionArbiter<Action>>();
     }
 };
 
@@ -124,11 +187,35 @@ public:
      * @param is_master If set to true, this instance will clear the shared
      *     memory on construction and destruction.  Only once instance should
      *     act as master in a multi-process setup.
-     * @param history_length History length of the time series.
+     * @param history_length History length of the time series.  The
+     *     history of the observation time series is scaled with
+     *     observations_per_action, so that it covers the same time span as the
+     *     others.
+     * @param observations_per_action Number of observations recorded per
+     *     action.  See RobotData::get_observations_per_action().  Has to be the
+     *     same in all processes.
+     * @param reattach Only relevant for the master.  If set to true and there
+     *     is data of a previous backend run in the shared memory (e.g. because
+     *     the backend process crashed and is restarted), the existing data is
+     *     kept instead of clearing it, so a new backend can resume after the
+     *     last index of the previous one.  In this case the shared memory is
+     *     not cleared on destruction either.  Frontends can detect the restart
+     *     of the backend through RobotFrontend::get_backend_generation().
+     * @param max_action_clients Only relevant for the master.  Maximum number
+     *     of ActionClients that can be registered at the same time.
+     *
+     * The master instance further creates the ObserverBuffer (see
+     * ObserverFrontend) and the ActionArbiter, so the backend should run in
+     * the process of the master.  Non-master instances can only use the
+     * arbiter if the master already existed when they were constructed.
      */
     MultiProcessRobotData(const std::string &shared_memory_id_prefix,
                           bool is_master,
-                          size_t history_length = 1000)
+                          size_t history_length = 1000,
+                          uint32_t observations_per_action = 1,
+                          bool reattach = false,
+                          size_t max_action_clients = 8)
+        : RobotData<Action, Observation>(observations_per_action)
     {
         std::cout << "Using multi process time series." << std::endl;
 
@@ -141,31 +228,115 @@ public:
         const std::string id_observation =
             shared_memory_id_prefix + "_observation";
         const std::string id_status = shared_memory_id_prefix + "_status";
+        id_control_block_ = shared_memory_id_prefix + "_control_block";
+        id_observer_buffer_ =
+            get_observer_buffer_shared_memory_id(shared_memory_id_prefix);
+        id_action_arbiter_ =
+            get_action_arbiter_shared_memory_id(shared_memory_id_prefix);
 
-        if (is_master)
+        // The control block is not cleared when the master starts, so that
+        // frontends of a previous run that are still attached to it are
+        // notified about the restart via the generation counter.
+        this->control_block =
+            create_multi_process_control_block(id_control_block_);
+
+        // a non-zero generation means that a backend was running on the data
+        // before
+        const bool attach_to_history =
+            is_master && reattach && this->control_block->generation > 0;
+        if (attach_to_history)
+        {
+            std::cout << "Reattach to existing data of generation "
+                      << this->control_block->generation << "." << std::endl;
+        }
+
+        if (is_master && !attach_to_history)
         {
             // the master instance is in charge of cleaning the memory
             time_series::clear_memory(id_desired_action);
             time_series::clear_memory(id_applied_action);
             time_series::clear_memory(id_observation);
             time_series::clear_memory(id_status);
+            this->control_block->reset();
         }
 
-        const bool clean_on_destruction = is_master;
+        clean_on_destruction_ = is_master && !attach_to_history;
 
         this->desired_action =
             std::make_shared<time_series::MultiprocessTimeSeries<Action>>(
-                id_desired_action, history_length, clean_on_destruction);
+                id_desired_action, history_length, clean_on_destruction_);
         this->applied_action =
             std::make_shared<time_series::MultiprocessTimeSeries<Action>>(
-                id_applied_action, history_length, clean_on_destruction);
+                id_applied_action, history_length, clean_on_destruction_);
         this->observation =
             std::make_shared<time_series::MultiprocessTimeSeries<Observation>>(
-                id_observation, history_length, clean_on_destruction);
+                id_observation,
+                history_length * observations_per_action,
+                clean_on_destruction_);
         this->status =
             std::make_shared<time_series::MultiprocessTimeSeries<Status>>(
-                id_status, history_length, clean_on_destruction);
+                id_status, history_length, clean_on_destruction_);
+
+        if (is_master)
+        {
+            // replaces the buffer of a previous run, also when reattaching
+            this->observer_buffer =
+                std::make_shared<ObserverBuffer<Observation>>(
+                    id_observer_buffer_,
+                    history_length * observations_per_action);
+            this->action_arbiter = std::make_shared<ActionArbiter<Action>>(
+                id_action_arbiter_, max_action_clients);
+        }
+        else
+        {
+            try
+            {
+                this->action_arbiter =
+                    std::make_shared<ActionArbiter<Action>>(id_action_arbiter_);
+            }
+            catch (const std::exception &)
+            {
+                // master does not exist yet, so no arbitration
+            }
+        }
     }
+
+    ~MultiProcessRobotData()
+    {
+        if (clean_on_destruction_)
+        {
+            clear_control_block(id_control_block_);
+            ObserverBuffer<Observation>::clear_memory(id_observer_buffer_);
+            ActionArbiter<Action>::clear_memory(id_action_arbiter_);
+        }
+    }
+
+
+    /**
+     * @brief Remove all shared memory segments of the given prefix.
+     *
+     * Use this to clean up robot data that was created in reattach mode.
+     *
+     * @param shared_memory_id_prefix See MultiProcessRobotData().
+     */
+    static void clear_memory(const std::string &shared_memory_id_prefix)
+    {
+        time_series::clear_memory(shared_memory_id_prefix + "_desired_action");
+        time_series::clear_memory(shared_memory_id_prefix + "_applied_action");
+        time_series::clear_memory(shared_memory_id_prefix + "_observation");
+        time_series::clear_memory(shared_memory_id_prefix + "_status");
+        clear_control_block(shared_memory_id_prefix + "_control_block");
+        ObserverBuffer<Observation>::clear_memory(
+            get_observer_buffer_shared_memory_id(shared_memory_id_prefix));
+        ActionArbiter<Action>::clear_memory(
+            get_action_arbiter_shared_memory_id(shared_memory_id_prefix));
+    }
+
+private:
+    std::string id_control_block_;
+    std::string id_observer_buffer_;
+    std::string id_action_arbiter_;
+    bool clean_on_destruction_;
 };
 
 }  // namespace robot_interfaces
@@ -9,13 +9,18 @@
 #pragma once
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <limits>
+#include <utility>
 
 #include <time_series/time_series.hpp>
 
+#include <robot_interfaces/observation_dispatcher.hpp>
 #include <robot_interfaces/robot_backend.hpp>
 #include <robot_interfaces/robot_data.hpp>
 #include <robot_interfaces/status.hpp>
+#include <robot_interfaces/wait_strategy.hpp>
 
 namespace robot_interfaces
 {
@@ -31,6 +36,11 @@ typedef time_series::Index TimeIndex;
  * thin wrapper around RobotData to facilitate interaction and also to make sure
  * the user cannot use RobotData in incorrect ways.
  *
+ * Observations and their timestamps are accessed by observation index, all
+ * other data by action index.  Both are the same unless the robot data records
+ * more than one observation per action, see get_observation_timeindex() and
+ * get_action_timeindex() for the mapping.
+ *
  * @tparam Action
  * @tparam Observation
  */
@@ -39,9 +49,67 @@ class RobotFrontend
 {
 public:
     typedef time_series::Timestamp TimeStamp;
+    typedef ObservationDispatcher<Observation> Dispatcher;
+
+    //! @brief Result of appending a desired action.
+    struct AppendResult
+    {
+        /**
+         * @brief False if the action was not appended because the buffer was
+         *     full until the timeout expired.
+         */
+        bool appended;
+        //! @brief Time index of the action (time_series::EMPTY if not
+        //! appended).
+        TimeIndex timeindex;
+        //! @brief Number of actions in the buffer that are not applied yet.
+        TimeIndex queued;
+    };
+
+    //! @brief Result of step().
+    struct StepResult
+    {
+        //! @brief Time index of the action.
+        TimeIndex timeindex;
+        //! @brief Observation of the step following the action.
+        Observation observation;
+        //! @brief Status of the step of this observation.
+        Status status;
+    };
+
+    /**
+     * @brief Predicted deadline for the next action.  See
+     *     get_action_deadline().
+     *
+     * Times are infinite if the backend does not need actions in time (i.e.
+     * it is not running in real-time mode or did not start yet) and NaN if
+     * they cannot be predicted yet (i.e. the backend did not complete a step
+     * yet).
+     */
+    struct ActionDeadline
+    {
+        //! @brief Time index the next appended action will get.
+        TimeIndex timeindex;
+        /**
+         * @brief Time until the backend needs the action.
+         *
+         * If the action is provided later, the previous action is repeated
+         * (if allowed).  Negative if the deadline is already exceeded.
+         */
+        double time_until_needed_s;
+        /**
+         * @brief Time until the backend stops with an error if no new action
+         *     is provided (i.e. when max_action_repetitions is exceeded).
+         */
+        double time_until_error_s;
+        //! @brief Predicted duration of a backend step.
+        double step_period_s;
+    };
 
     RobotFrontend(std::shared_ptr<RobotData<Action, Observation>> robot_data)
-        : robot_data_(robot_data)
+        : robot_data_(robot_data),
+          observation_dispatcher_(std::make_shared<Dispatcher>(
+              robot_data->observation, robot_data->control_block))
     {
     }
 
@@ -62,6 +130,57 @@ public:
         return (*robot_data_->status)[t];
     }
 
+    /**
+     * @brief Call a function with the observation of time index t.
+     *
+     * Alternative to get_observation() for large observation types where
+     * callers only need some of the fields: the visitor gets a const
+     * reference, so no further copies are made, regardless of how the result
+     * is used.  Note that the time series only provide copies of their
+     * elements, so the observation is still copied once from the time series.
+     *
+     * @param t  Time index of the observation.
+     * @param visitor  Function that is called as `visitor(const Observation&)`.
+     * @return Return value of the visitor.
+     */
+    template <typename Visitor>
+    auto with_observation(const TimeIndex &t, Visitor visitor) const
+        -> decltype(visitor(std::declval<const Observation &>()))
+    {
+        const Observation observation = (*robot_data_->observation)[t];
+        return visitor(observation);
+    }
+
+    //! @brief Call a function with the desired action of time index t.
+    //! @see with_observation()
+    template <typename Visitor>
+    auto with_desired_action(const TimeIndex &t, Visitor visitor) const
+        -> decltype(visitor(std::declval<const Action &>()))
+    {
+        const Action action = (*robot_data_->desired_action)[t];
+        return visitor(action);
+    }
+
+    //! @brief Call a function with the applied action of time index t.
+    //! @see with_observation()
+    template <typename Visitor>
+    auto with_applied_action(const TimeIndex &t, Visitor visitor) const
+        -> decltype(visitor(std::declval<const Action &>()))
+    {
+        const Action action = (*robot_data_->applied_action)[t];
+        return visitor(action);
+    }
+
+    //! @brief Call a function with the status of time index t.
+    //! @see with_observation()
+    template <typename Visitor>
+    auto with_status(const TimeIndex &t, Visitor visitor) const
+        -> decltype(visitor(std::declval<const Status &>()))
+    {
+        const Status status = (*robot_data_->status)[t];
+        return visitor(status);
+    }
+
     //! @deprecated Use get_timestamp_ms instead
     [[deprecated]] TimeStamp get_time_stamp_ms(const TimeIndex &t) const
     {
@@ -76,11 +195,242 @@ public:
         return robot_data_->observation->newest_timeindex();
     }
 
+    /**
+     * @brief Number of observations that are recorded per action.
+     *
+     * See RobotData::get_observations_per_action().
+     */
+    uint32_t get_observations_per_action() const
+    {
+        return robot_data_->get_observations_per_action();
+    }
+
+    /**
+     * @brief Get index of the observation at which an action is applied.
+     *
+     * @param action_t  Time index of the action.
+     * @return Index of the observation that is recorded right before the action
+     *     with index `action_t` is applied.
+     */
+    TimeIndex get_observation_timeindex(const TimeIndex &action_t) const
+    {
+        return action_t * robot_data_->get_observations_per_action();
+    }
+
+    /**
+     * @brief Get index of the action that is applied at an observation.
+     *
+     * @param observation_t  Time index of the observation.
+     * @return Index of the action that is applied in the step of observation
+     *     `observation_t`.
+     */
+    TimeIndex get_action_timeindex(const TimeIndex &observation_t) const
+    {
+        return observation_t / robot_data_->get_observations_per_action();
+    }
+
+    /**
+     * @brief Get the number of times a backend has been started on the data.
+     *
+     * This is only a single atomic load, so it can be called frequently.
+     * Compare the value with a previously obtained one to detect if the
+     * backend has been restarted in the meantime.
+     */
+    uint64_t get_backend_generation() const
+    {
+        return robot_data_->control_block->generation;
+    }
+
+    /**
+     * @brief Check if the running backend has reported an error.
+     *
+     * Only checks the error flag of the control block, which is much cheaper
+     * than reading the newest status.  Use get_status() to get details about
+     * the error.
+     */
+    bool has_backend_error() const
+    {
+        const ControlBlock &control_block = *robot_data_->control_block;
+        const uint64_t error_generation = control_block.error_generation.load();
+        return error_generation != 0 &&
+               error_generation == control_block.generation.load();
+    }
+
+    /**
+     * @brief Check if the backend has terminated.
+     *
+     * This is the case once the loop of the current backend has ended, either
+     * because of an error (see has_backend_error()) or because it was shut
+     * down.  For remote robot data it is also the case if the connection is
+     * lost.
+     */
+    bool is_backend_terminated() const
+    {
+        const ControlBlock &control_block = *robot_data_->control_block;
+        const uint64_t terminated_generation =
+            control_block.terminated_generation.load();
+        return terminated_generation != 0 &&
+               terminated_generation == control_block.generation.load();
+    }
+
+    /**
+     * @brief Predict when the backend needs the next action.
+     *
+     * Meant for controllers that can adapt their computation time (e.g. the
+     * number of solver iterations) to the time that is left.  The prediction
+     * is based on the start time of the current step of the backend and the
+     * moving average of its step duration.  It assumes that the backend needs
+     * the action at the beginning of the step, i.e. it ignores the time for
+     * getting the observation, so it is slightly conservative.
+     *
+     * The values are published by the backend via the control block, so this
+     * is cheap and does not access the time series.
+     */
+    ActionDeadline get_action_deadline() const
+    {
+        const ControlBlock &control_block = *robot_data_->control_block;
+
+        int64_t step, start_time_ns, period_ns, max_repetitions;
+        uint32_t repetitions;
+        control_block.read_step(
+            step, start_time_ns, period_ns, repetitions, max_repetitions);
+
+        ActionDeadline deadline;
+        deadline.timeindex = control_block.newest_desired_action.load() + 1;
+
+        if (step < 0 || max_repetitions < 0)
+        {
+            deadline.time_until_needed_s =
+                std::numeric_limits<double>::infinity();
+            deadline.time_until_error_s =
+                std::numeric_limits<double>::infinity();
+            deadline.step_period_s =
+                period_ns > 0 ? period_ns * 1e-9
+                              : std::numeric_limits<double>::quiet_NaN();
+            return deadline;
+        }
+        if (period_ns == 0)
+        {
+            deadline.time_until_needed_s =
+                std::numeric_limits<double>::quiet_NaN();
+            deadline.time_until_error_s =
+                std::numeric_limits<double>::quiet_NaN();
+            deadline.step_period_s = std::numeric_limits<double>::quiet_NaN();
+            return deadline;
+        }
+
+        // the backend has taken (or repeated) the action of the current step
+        // already, unless it is just checking for it
+        deadline.timeindex = std::max(deadline.timeindex, step);
+
+        // Repetitions of the current step count towards the limit if the
+        // action is needed right after it.  Later actions start from zero as
+        // there are queued actions in between.
+        const int64_t remaining_repetitions =
+            deadline.timeindex <= step + 1 ? max_repetitions - repetitions
+                                           : max_repetitions;
+        const int64_t error_step = deadline.timeindex + remaining_repetitions;
+
+        const double elapsed_s =
+            (std::chrono::duration_cast<std::chrono::nanoseconds>(
+                 std::chrono::steady_clock::now().time_since_epoch())
+                 .count() -
+             start_time_ns) *
+            1e-9;
+        deadline.step_period_s = period_ns * 1e-9;
+        deadline.time_until_needed_s =
+            (deadline.timeindex - step) * deadline.step_period_s - elapsed_s;
+        deadline.time_until_error_s =
+            (error_step - step) * deadline.step_period_s - elapsed_s;
+
+        return deadline;
+    }
+
+    /**
+     * @brief Create a client for submitting actions via the action arbiter.
+     *
+     * Use this instead of append_desired_action() if several controllers
+     * should command the robot at the same time.  The backend then takes the
+     * action of the client with the highest priority (or merges the actions,
+     * see ActionArbiter::set_merge_function()).  Do not mix this with
+     * append_desired_action(), as directly appended actions are used before
+     * the arbiter is asked.
+     *
+     * @param priority  Priority of the client.
+     * @throws std::runtime_error if the robot data has no action arbiter.
+     */
+    std::shared_ptr<ActionClient<Action>> create_action_client(
+        const int32_t priority)
+    {
+        if (!robot_data_->action_arbiter)
+        {
+            throw std::runtime_error(
+                "Robot data does not provide an action arbiter.");
+        }
+        return std::make_shared<ActionClient<Action>>(
+            robot_data_->action_arbiter, robot_data_->control_block, priority);
+    }
+
+    /**
+     * @brief Append a desired action.
+     *
+     * If the buffer of desired actions is full (i.e. appending would drop an
+     * action that is not applied yet), this blocks until the backend has
+     * applied the oldest action.  See the overload with timeout and
+     * try_append_desired_action() for alternatives.
+     *
+     * @param desired_action  The action.
+     * @return Time index of the action.
+     * @throws std::runtime_error if the backend reported an error.
+     */
     TimeIndex append_desired_action(const Action &desired_action)
+    {
+        return append_desired_action(desired_action,
+                                     std::numeric_limits<double>::infinity())
+            .timeindex;
+    }
+
+    /**
+     * @brief Append a desired action if it is possible without blocking.
+     *
+     * Same as append_desired_action() with a timeout of zero.
+     */
+    AppendResult try_append_desired_action(const Action &desired_action)
+    {
+        return append_desired_action(desired_action, 0.0);
+    }
+
+    /**
+     * @brief Get the number of appends that found the buffer of desired
+     *     actions full.
+     *
+     * Counted over all frontends of the robot data, whether they waited or
+     * gave up.  Increasing values indicate that actions are produced faster
+     * than the backend can apply them.
+     */
+    uint64_t get_number_of_blocked_appends() const
+    {
+        return robot_data_->control_block->num_blocked_appends;
+    }
+
+    /**
+     * @brief Append a desired action, waiting at most the given time if the
+     *     buffer is full.
+     *
+     * @param desired_action  The action.
+     * @param max_duration_s  Maximum time to wait for the backend to apply the
+     *     oldest action if the buffer of desired actions is full.
+     * @return Whether the action was appended, its time index and the number
+     *     of actions in the buffer that are not applied yet.
+     * @throws std::runtime_error if the backend reported an error.
+     */
+    AppendResult append_desired_action(const Action &desired_action,
+                                       const double max_duration_s)
     {
         // check error state. do not allow appending actions if there is an
-        // error
-        if (robot_data_->status->length() > 0)
+        // error.  The status is only read if the backend has flagged an error,
+        // otherwise checking takes just two atomic loads.
+        if (has_backend_error())
         {
             const Status status = robot_data_->status->newest_element();
             switch (status.error_status)
@@ -102,30 +452,255 @@ public:
         // since the timeseries has a finite memory, we need to make sure that
         // by appending new actions we do not forget about actions which have
         // not been applied yet
-        if (robot_data_->desired_action->length() ==
-                robot_data_->desired_action->max_length() &&
-            robot_data_->desired_action->oldest_timeindex() ==  // FIXME >=
-                get_current_timeindex())
+        typedef std::chrono::steady_clock Clock;
+        const Clock::time_point start = Clock::now();
+        bool is_blocked = false;
+        while (is_desired_action_buffer_full())
         {
-            std::cout
-                << "you have been appending actions too fast, waiting for "
-                   "RobotBackend to catch up with executing actions."
-                << std::endl;
-            wait_until_timeindex(
-                robot_data_->desired_action->oldest_timeindex() + 1);
+            if (!is_blocked)
+            {
+                is_blocked = true;
+                robot_data_->control_block->num_blocked_appends++;
+            }
+
+            const double remaining_duration_s =
+                max_duration_s -
+                std::chrono::duration<double>(Clock::now() - start).count();
+            const TimeIndex oldest_t =
+                robot_data_->desired_action->oldest_timeindex();
+            if (remaining_duration_s <= 0 ||
+                !wait_until_timeindex(get_observation_timeindex(oldest_t + 1),
+                                      remaining_duration_s))
+            {
+                AppendResult result;
+                result.appended = false;
+                result.timeindex = time_series::EMPTY;
+                result.queued = count_queued_actions(
+                    robot_data_->desired_action->newest_timeindex());
+                return result;
+            }
         }
 
         robot_data_->desired_action->append(desired_action);
-        return robot_data_->desired_action->newest_timeindex();
+        const TimeIndex t = robot_data_->desired_action->newest_timeindex();
+        publish_timeindex(robot_data_->control_block->newest_desired_action,
+                          t);
+        robot_data_->control_block->notify();
+
+        AppendResult result;
+        result.appended = true;
+        result.timeindex = t;
+        result.queued = count_queued_actions(t);
+        return result;
     }
 
+    /**
+     * @brief Wait until the observation with index t is available.
+     *
+     * Uses the wait strategy of the robot data (see RobotData::wait_strategy).
+     */
     void wait_until_timeindex(const TimeIndex &t) const
     {
-        robot_data_->observation->timestamp_ms(t);
+        wait_until_timeindex(t, std::numeric_limits<double>::infinity());
+    }
+
+    /**
+     * @brief Wait until the observation with index t is available or the
+     *     timeout expires.
+     *
+     * Uses the wait strategy of the robot data (see RobotData::wait_strategy).
+     *
+     * @param t  Observation index to wait for.
+     * @param max_duration_s  Maximum time to wait.  Set to infinity to wait
+     *     without timeout.
+     * @return True if the observation is available, false if the timeout
+     *     expired.
+     */
+    bool wait_until_timeindex(const TimeIndex &t,
+                              const double max_duration_s) const
+    {
+        return wait_for_timeindex(
+            robot_data_->wait_strategy,
+            robot_data_->control_block->newest_observation,
+            *robot_data_->observation,
+            t,
+            max_duration_s);
+    }
+
+    /**
+     * @brief Check if the observation with index t is available, without
+     *     blocking.
+     */
+    bool try_wait_until_timeindex(const TimeIndex &t) const
+    {
+        return robot_data_->control_block->newest_observation.load() >= t ||
+               robot_data_->observation->newest_timeindex(false) >= t;
+    }
+
+    /**
+     * @brief Wait until there is an observation newer than t.
+     *
+     * @param t  Observation index.  Pass time_series::EMPTY to wait for the
+     *     first observation.
+     * @param max_duration_s  Maximum time to wait.  Set to infinity to wait
+     *     without timeout.
+     * @return Index of the newest observation.  Only greater than t if there
+     *     is a newer observation, i.e. not if the timeout expired.
+     */
+    TimeIndex wait_for_any_newer_than(
+        const TimeIndex &t,
+        const double max_duration_s =
+            std::numeric_limits<double>::infinity()) const
+    {
+        wait_until_timeindex(t + 1, max_duration_s);
+        return robot_data_->observation->newest_timeindex(false);
+    }
+
+    /**
+     * @brief Subscribe to new observations.
+     *
+     * The callback is called from a dispatcher thread for each new
+     * observation, batching consecutive observations if the callbacks fall
+     * behind.  All subscriptions of the frontend (and its copies) share the
+     * same dispatcher thread, which is started with the first subscription.
+     * See ObservationDispatcher for details.
+     *
+     * @param callback  Function that is called with new observations.
+     * @return ID of the subscription, to be used for
+     *     unsubscribe_observations().
+     */
+    typename Dispatcher::SubscriptionId subscribe_observations(
+        const typename Dispatcher::Callback &callback)
+    {
+        return observation_dispatcher_->subscribe(callback);
+    }
+
+    /**
+     * @brief Cancel a subscription made with subscribe_observations().
+     *
+     * When this returns, the callback is not running and will not be called
+     * anymore.
+     */
+    void unsubscribe_observations(
+        const typename Dispatcher::SubscriptionId &subscription_id)
+    {
+        observation_dispatcher_->unsubscribe(subscription_id);
+    }
+
+    /**
+     * @brief Get a file descriptor that is signalled on new observations.
+     *
+     * Allows waiting for new observations in an event loop (poll, epoll,
+     * select, ...) together with other file descriptors, without a thread of
+     * its own.  Reading the file descriptor returns the number of new
+     * observations since the last read (as 8 byte integer).  The status of a
+     * step is appended shortly after its observation, so use
+     * wait_until_timeindex() if both are needed.
+     *
+     * This also works if the backend runs in another process, as the
+     * notification happens through a dispatcher thread in this process (see
+     * ObservationDispatcher::get_event_fd() for details).
+     *
+     * @return The file descriptor.  It is owned by the frontend and must not
+     *     be closed by the caller.
+     */
+    int get_observation_event_fd()
+    {
+        return observation_dispatcher_->get_event_fd();
+    }
+
+    /**
+     * @brief Apply an action and get the resulting observation and status.
+     *
+     * Combines append_desired_action(), wait_until_timeindex() and the
+     * getters for the typical control cycle in a single call, waiting only
+     * once.
+     *
+     * The returned observation and status are those of the step following the
+     * action, i.e. the observation with index `get_observation_timeindex(t +
+     * 1)` and the status with index `t + 1`.  This includes errors that
+     * occurred while applying the action.  Note that with multiple
+     * observations per action, this is not the first observation recorded
+     * after the action was applied but the one after the action was held for
+     * its full duration.
+     *
+     * If the backend terminates with an error before the step is completed,
+     * the newest observation and the error status are returned.
+     *
+     * @param desired_action  The action that is appended.
+     * @return Time index of the action together with the resulting observation
+     *     and status.
+     * @throws std::runtime_error if the backend terminates without error
+     *     before the step is completed (e.g. because it was shut down).
+     */
+    StepResult step(const Action &desired_action)
+    {
+        StepResult result;
+        result.timeindex = append_desired_action(desired_action);
+
+        const TimeIndex next_t = result.timeindex + 1;
+        const TimeIndex observation_t = get_observation_timeindex(next_t);
+
+        // wait with timeout to notice if the backend terminates, in which
+        // case the step is never completed.  The backend appends the status
+        // right after the observation.
+        constexpr double error_check_interval_s = 0.1;
+        while (!(wait_until_timeindex(observation_t, error_check_interval_s) &&
+                 robot_data_->status->wait_for_timeindex(
+                     next_t, error_check_interval_s)))
+        {
+            if (has_backend_error())
+            {
+                if (robot_data_->observation->length() > 0)
+                {
+                    result.observation =
+                        robot_data_->observation->newest_element();
+                }
+                result.status = robot_data_->status->newest_element();
+                return result;
+            }
+            if (is_backend_terminated())
+            {
+                throw std::runtime_error(
+                    "Backend terminated before the step was completed.");
+            }
+        }
+
+        result.observation = (*robot_data_->observation)[observation_t];
+        result.status = (*robot_data_->status)[next_t];
+
+        return result;
     }
 
 protected:
     std::shared_ptr<RobotData<Action, Observation>> robot_data_;
+    std::shared_ptr<Dispatcher> observation_dispatcher_;
+
+    /**
+     * @brief Check if appending a desired action would drop one that is not
+     *     applied yet.
+     */
+    bool is_desired_action_buffer_full() const
+    {
+        if (robot_data_->desired_action->length() <
+            robot_data_->desired_action->max_length())
+        {
+            return false;
+        }
+
+        // index of the action of the current step, which is not applied yet
+        // (or currently being applied)
+        const TimeIndex current_action_t = get_action_timeindex(
+            robot_data_->observation->newest_timeindex(false));
+        return robot_data_->desired_action->oldest_timeindex() >=
+               current_action_t;
+    }
+
+    //! @brief Number of actions up to newest_t that are not applied yet.
+    TimeIndex count_queued_actions(const TimeIndex &newest_t) const
+    {
+        return newest_t - robot_data_->applied_action->newest_timeindex(false);
+    }
 };
 
 }  // namespace robot_interfaces
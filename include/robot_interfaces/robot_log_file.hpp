@@ -0,0 +1,248 @@
+/**
+ * @file
+ * @brief Binary file format of the RobotLogger.
+ * @copyright 2020, Max Planck Gesellschaft. All rights reserved.
+ * @license BSD 3-clause
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace robot_interfaces
+{
+//! @brief File formats of the RobotLogger.
+enum class RobotLogFormat
+{
+    //! @brief One line of whitespace-separated values per time index.
+    TEXT,
+    //! @brief Binary file with one fixed-width record per time index.
+    BINARY,
+    //! @brief Binary file with the records stored in chunks, column by column.
+    BINARY_COLUMN_CHUNKS
+};
+
+/**
+ * @brief Layout of the data in a binary log file.
+ *
+ * In both layouts, all values are stored as double, so each record (i.e. the
+ * data of one time index) has a fixed size of 8 bytes per column.
+ */
+enum class RobotLogLayout : uint32_t
+{
+    //! @brief Records are stored one after the other.
+    RECORDS = 0,
+    /**
+     * @brief Records are grouped in chunks of fixed size and each chunk is
+     * stored column by column, i.e. first the values of the first column of
+     * all records of the chunk, then the ones of the second column, and so
+     * on.  Only the last chunk may contain less records.
+     */
+    COLUMN_CHUNKS = 1
+};
+
+/**
+ * @brief Header at the beginning of a binary log file.
+ *
+ * The header is followed by the names of the columns, each stored as its
+ * length (uint32) and the characters.  The data starts at header_size bytes
+ * from the beginning of the file, which is a multiple of 8.  All values are
+ * stored in host byte order.
+ */
+struct RobotLogFileHeader
+{
+    char magic[8];
+    //! @brief Size of the header including column names and padding.
+    uint32_t header_size;
+    //! @brief See RobotLogLayout.
+    uint32_t layout;
+    uint32_t num_columns;
+    //! @brief Number of records per chunk (only for COLUMN_CHUNKS).
+    uint32_t chunk_size;
+
+    //! @brief Identifies binary robot logs (including the format version).
+    static const char *get_magic()
+    {
+        return "RILOGB1";
+    }
+};
+
+/**
+ * @brief Writes binary log files, see RobotLogFileHeader.
+ *
+ * Data is buffered, so nothing is lost as long as close() is called (which
+ * the destructor does).
+ */
+class RobotBinaryLogWriter
+{
+public:
+    /**
+     * @brief Create the log file and write the header.
+     *
+     * An existing file is overwritten.
+     *
+     * @param filename  Path of the log file.
+     * @param column_names  Names of the columns.
+     * @param layout  Layout of the data.
+     * @param chunk_size  Number of records per chunk.  Only relevant for
+     *     RobotLogLayout::COLUMN_CHUNKS.
+     * @throws std::runtime_error if the file cannot be opened.
+     */
+    RobotBinaryLogWriter(const std::string &filename,
+                         const std::vector<std::string> &column_names,
+                         const RobotLogLayout layout,
+                         const uint32_t chunk_size = 1000)
+        : layout_(layout),
+          num_columns_(column_names.size()),
+          chunk_size_(layout == RobotLogLayout::COLUMN_CHUNKS ? chunk_size : 1),
+          num_chunk_records_(0)
+    {
+        if (chunk_size_ == 0)
+        {
+            throw std::invalid_argument(
+                "chunk_size must be greater than zero.");
+        }
+
+        file_.open(filename, std::ios::binary | std::ios::trunc);
+        if (!file_)
+        {
+            throw std::runtime_error("Failed to open log file " + filename);
+        }
+
+        write_header(column_names);
+        chunk_.resize(num_columns_ * chunk_size_);
+    }
+
+    ~RobotBinaryLogWriter()
+    {
+        close();
+    }
+
+    size_t get_number_of_columns() const
+    {
+        return num_columns_;
+    }
+
+    /**
+     * @brief Append a record.
+     *
+     * @param values  Values of all columns (get_number_of_columns()).
+     */
+    void append_record(const double *values)
+    {
+        if (layout_ == RobotLogLayout::RECORDS)
+        {
+            write(values, num_columns_);
+            return;
+        }
+
+        for (size_t c = 0; c < num_columns_; c++)
+        {
+            chunk_[c * chunk_size_ + num_chunk_records_] = values[c];
+        }
+        num_chunk_records_++;
+        if (num_chunk_records_ == chunk_size_)
+        {
+            write_chunk();
+        }
+    }
+
+    /**
+     * @brief Append a record.
+     *
+     * @throws std::invalid_argument if the number of values does not match
+     *     the number of columns.
+     */
+    void append_record(const std::vector<double> &values)
+    {
+        if (values.size() != num_columns_)
+        {
+            throw std::invalid_argument(
+                "Record has " + std::to_string(values.size()) +
+                " values but the log has " + std::to_string(num_columns_) +
+                " columns.");
+        }
+        append_record(values.data());
+    }
+
+    //! @brief Write the buffered data and close the file.
+    void close()
+    {
+        if (!file_.is_open())
+        {
+            return;
+        }
+        write_chunk();
+        file_.close();
+    }
+
+private:
+    std::ofstream file_;
+    const RobotLogLayout layout_;
+    const size_t num_columns_;
+    const size_t chunk_size_;
+
+    //! @brief Records of the current chunk, column by column.
+    std::vector<double> chunk_;
+    size_t num_chunk_records_;
+
+    void write(const double *values, const size_t count)
+    {
+        file_.write(reinterpret_cast<const char *>(values),
+                    count * sizeof(double));
+    }
+
+    void write_chunk()
+    {
+        if (num_chunk_records_ == 0)
+        {
+            return;
+        }
+        // the last chunk may be incomplete, then only the records that exist
+        // are written
+        for (size_t c = 0; c < num_columns_; c++)
+        {
+            write(&chunk_[c * chunk_size_], num_chunk_records_);
+        }
+        num_chunk_records_ = 0;
+    }
+
+    void write_header(const std::vector<std::string> &column_names)
+    {
+        RobotLogFileHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::strncpy(header.magic,
+                     RobotLogFileHeader::get_magic(),
+                     sizeof(header.magic));
+        header.layout = static_cast<uint32_t>(layout_);
+        header.num_columns = num_columns_;
+        header.chunk_size = chunk_size_;
+
+        size_t size = sizeof(header);
+        for (const std::string &name : column_names)
+        {
+            size += sizeof(uint32_t) + name.size();
+        }
+        // data is aligned, so it can be mapped and accessed directly
+        header.header_size = (size + sizeof(double) - 1) / sizeof(double) *
+                             sizeof(double);
+
+        file_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        for (const std::string &name : column_names)
+        {
+            const uint32_t length = name.size();
+            file_.write(reinterpret_cast<const char *>(&length),
+                        sizeof(length));
+            file_.write(name.data(), length);
+        }
+        const std::vector<char> padding(header.header_size - size, 0);
+        file_.write(padding.data(), padding.size());
+    }
+};
+
+}  // namespace robot_interfaces
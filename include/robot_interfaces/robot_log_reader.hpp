@@ -0,0 +1,434 @@
+/**
+ * @file
+ * @brief Reader for the binary log files of the RobotLogger.
+ * @copyright 2020, Max Planck Gesellschaft. All rights reserved.
+ * @license BSD 3-clause
+ */
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "robot_log_file.hpp"
+
+namespace robot_interfaces
+{
+/**
+ * @brief View on (a part of) a column of a log file, without copying.
+ *
+ * Value i is at `data[i * stride]`.
+ */
+struct RobotLogColumnView
+{
+    const double *data;
+    //! @brief Number of values.
+    size_t size;
+    //! @brief Distance between two values (in number of doubles).
+    size_t stride;
+
+    double operator[](const size_t i) const
+    {
+        return data[i * stride];
+    }
+};
+
+/**
+ * @brief Random access to binary log files written by the RobotLogger.
+ *
+ * The file is mapped to memory, so opening it is fast independent of its
+ * size and values are only read from disk when they are accessed.  Values
+ * and columns can be accessed by record (i.e. the position in the file),
+ * records can be looked up by time index and timestamp if the log has the
+ * columns "time_index" and "timestamp" (which is the case for logs of the
+ * RobotLogger).  Lookups read these columns directly from the mapped file,
+ * no index is built in memory.
+ *
+ * Supports both layouts of RobotLogLayout.  Files in the RECORDS layout can
+ * also be opened while they are still written (only complete records at the
+ * time of opening are visible), COLUMN_CHUNKS files only once they are
+ * closed.
+ */
+class RobotLogReader
+{
+public:
+    /**
+     * @brief Open a log file.
+     *
+     * @param filename  Path to the binary log file.
+     * @throws std::runtime_error if the file cannot be opened or is not a
+     *     valid binary log file.
+     */
+    RobotLogReader(const std::string &filename)
+    {
+        const int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error("Failed to open log file " + filename);
+        }
+
+        struct stat file_status;
+        if (::fstat(fd, &file_status) != 0 ||
+            static_cast<size_t>(file_status.st_size) <
+                sizeof(RobotLogFileHeader))
+        {
+            ::close(fd);
+            throw std::runtime_error(filename + " is not a binary log file.");
+        }
+
+        mapped_size_ = file_status.st_size;
+        void *mapped = ::mmap(
+            nullptr, mapped_size_, PROT_READ, MAP_SHARED, fd, 0);
+        // the mapping stays valid after closing the file
+        ::close(fd);
+        if (mapped == MAP_FAILED)
+        {
+            throw std::runtime_error("Failed to map log file " + filename);
+        }
+        mapped_ = static_cast<const char *>(mapped);
+
+        try
+        {
+            read_header(filename);
+            find_index_columns();
+        }
+        catch (...)
+        {
+            ::munmap(const_cast<char *>(mapped_), mapped_size_);
+            throw;
+        }
+    }
+
+    ~RobotLogReader()
+    {
+        ::munmap(const_cast<char *>(mapped_), mapped_size_);
+    }
+
+    RobotLogReader(const RobotLogReader &) = delete;
+    RobotLogReader &operator=(const RobotLogReader &) = delete;
+
+    RobotLogLayout get_layout() const
+    {
+        return layout_;
+    }
+
+    const std::vector<std::string> &get_column_names() const
+    {
+        return column_names_;
+    }
+
+    size_t get_number_of_columns() const
+    {
+        return column_names_.size();
+    }
+
+    size_t get_number_of_records() const
+    {
+        return num_records_;
+    }
+
+    /**
+     * @brief Get the index of the column with the given name.
+     *
+     * @throws std::invalid_argument if there is no such column.
+     */
+    size_t get_column_index(const std::string &name) const
+    {
+        const auto it =
+            std::find(column_names_.begin(), column_names_.end(), name);
+        if (it == column_names_.end())
+        {
+            throw std::invalid_argument("Log has no column " + name);
+        }
+        return it - column_names_.begin();
+    }
+
+    /**
+     * @brief Get a value.
+     *
+     * @param record  Index of the record (not the time index, see
+     *     find_record()).
+     * @param column  Index of the column.
+     * @throws std::out_of_range if record or column is invalid.
+     */
+    double get_value(const size_t record, const size_t column) const
+    {
+        check_record(record);
+        check_column(column);
+        return data_[get_offset(record, column)];
+    }
+
+    //! @brief Get all values of a record (see get_value()).
+    std::vector<double> get_record(const size_t record) const
+    {
+        check_record(record);
+        std::vector<double> values(get_number_of_columns());
+        for (size_t c = 0; c < values.size(); c++)
+        {
+            values[c] = data_[get_offset(record, c)];
+        }
+        return values;
+    }
+
+    /**
+     * @brief Get views on all values of a column.
+     *
+     * For RobotLogLayout::RECORDS this is a single strided view, for
+     * RobotLogLayout::COLUMN_CHUNKS it is one contiguous view per chunk.
+     * The views point into the mapped file, so they are only valid as long
+     * as the reader exists.
+     *
+     * @throws std::out_of_range if the column is invalid.
+     */
+    std::vector<RobotLogColumnView> get_column_views(const size_t column) const
+    {
+        check_column(column);
+        std::vector<RobotLogColumnView> views;
+
+        if (layout_ == RobotLogLayout::RECORDS)
+        {
+            if (num_records_ > 0)
+            {
+                views.push_back({data_ + column,
+                                 num_records_,
+                                 get_number_of_columns()});
+            }
+            return views;
+        }
+
+        for (size_t first = 0; first < num_records_; first += chunk_size_)
+        {
+            views.push_back({data_ + get_offset(first, column),
+                             get_chunk_length(first),
+                             1});
+        }
+        return views;
+    }
+
+    /**
+     * @brief Find the record of a time index.
+     *
+     * This is constant time unless the log has gaps (the RobotLogger skips
+     * time indices that were dropped from the history before being logged),
+     * then it falls back to a binary search.
+     *
+     * @return Index of the record.
+     * @throws std::invalid_argument if the log has no time_index column.
+     * @throws std::out_of_range if the time index is not in the log.
+     */
+    size_t find_record(const int64_t time_index) const
+    {
+        if (!has_time_index_)
+        {
+            throw std::invalid_argument("Log has no column time_index.");
+        }
+
+        if (num_records_ > 0)
+        {
+            const int64_t first_time_index =
+                data_[get_offset(0, time_index_column_)];
+            if (time_index >= first_time_index)
+            {
+                const size_t guess = time_index - first_time_index;
+                if (guess < num_records_ &&
+                    static_cast<int64_t>(data_[get_offset(
+                        guess, time_index_column_)]) == time_index)
+                {
+                    return guess;
+                }
+            }
+        }
+
+        const size_t record =
+            lower_bound(time_index_column_, static_cast<double>(time_index));
+        if (record == num_records_ ||
+            static_cast<int64_t>(data_[get_offset(
+                record, time_index_column_)]) != time_index)
+        {
+            throw std::out_of_range("Time index " +
+                                    std::to_string(time_index) +
+                                    " is not in the log.");
+        }
+        return record;
+    }
+
+    /**
+     * @brief Find the first record with a timestamp not before the given one.
+     *
+     * Uses a binary search on the timestamp column.
+     *
+     * @return Index of the record, get_number_of_records() if all records are
+     *     older.
+     * @throws std::invalid_argument if the log has no timestamp column.
+     */
+    size_t find_record_by_timestamp(const double timestamp) const
+    {
+        if (!has_timestamp_)
+        {
+            throw std::invalid_argument("Log has no column timestamp.");
+        }
+        return lower_bound(timestamp_column_, timestamp);
+    }
+
+private:
+    const char *mapped_;
+    size_t mapped_size_;
+    const double *data_;
+
+    RobotLogLayout layout_;
+    size_t chunk_size_;
+    std::vector<std::string> column_names_;
+    size_t num_records_;
+
+    bool has_time_index_;
+    bool has_timestamp_;
+    //! @brief Index of the time_index column (if has_time_index_).
+    size_t time_index_column_;
+    //! @brief Index of the timestamp column (if has_timestamp_).
+    size_t timestamp_column_;
+
+    void read_header(const std::string &filename)
+    {
+        const std::string invalid_file =
+            filename + " is not a valid binary log file.";
+
+        RobotLogFileHeader header;
+        std::memcpy(&header, mapped_, sizeof(header));
+        if (std::strncmp(header.magic,
+                         RobotLogFileHeader::get_magic(),
+                         sizeof(header.magic)) != 0 ||
+            header.header_size > mapped_size_ ||
+            header.header_size % sizeof(double) != 0 ||
+            header.num_columns == 0 || header.chunk_size == 0 ||
+            header.layout > static_cast<uint32_t>(
+                                RobotLogLayout::COLUMN_CHUNKS))
+        {
+            throw std::runtime_error(invalid_file);
+        }
+        layout_ = static_cast<RobotLogLayout>(header.layout);
+        chunk_size_ = header.chunk_size;
+
+        size_t position = sizeof(header);
+        for (uint32_t i = 0; i < header.num_columns; i++)
+        {
+            uint32_t length;
+            if (position + sizeof(length) > header.header_size)
+            {
+                throw std::runtime_error(invalid_file);
+            }
+            std::memcpy(&length, mapped_ + position, sizeof(length));
+            position += sizeof(length);
+            if (position + length > header.header_size)
+            {
+                throw std::runtime_error(invalid_file);
+            }
+            column_names_.emplace_back(mapped_ + position, length);
+            position += length;
+        }
+
+        // the header size is a multiple of 8, so the data is aligned
+        data_ = reinterpret_cast<const double *>(mapped_ + header.header_size);
+        const size_t num_values =
+            (mapped_size_ - header.header_size) / sizeof(double);
+        num_records_ = num_values / get_number_of_columns();
+        if (layout_ == RobotLogLayout::COLUMN_CHUNKS)
+        {
+            // only complete chunks are written, except for the last one
+            const size_t chunk_values = chunk_size_ * get_number_of_columns();
+            num_records_ = num_values / chunk_values * chunk_size_ +
+                           num_values % chunk_values / get_number_of_columns();
+        }
+    }
+
+    void find_index_columns()
+    {
+        has_time_index_ = std::find(column_names_.begin(),
+                                    column_names_.end(),
+                                    "time_index") != column_names_.end();
+        has_timestamp_ = std::find(column_names_.begin(),
+                                   column_names_.end(),
+                                   "timestamp") != column_names_.end();
+
+        if (has_time_index_)
+        {
+            time_index_column_ = get_column_index("time_index");
+        }
+        if (has_timestamp_)
+        {
+            timestamp_column_ = get_column_index("timestamp");
+        }
+    }
+
+    /**
+     * @brief Find the first record whose value in a column is not less than
+     *     the given one.
+     *
+     * The values of the column have to be sorted.
+     *
+     * @return Index of the record, num_records_ if all values are less.
+     */
+    size_t lower_bound(const size_t column, const double value) const
+    {
+        size_t first = 0;
+        size_t count = num_records_;
+        while (count > 0)
+        {
+            const size_t step = count / 2;
+            if (data_[get_offset(first + step, column)] < value)
+            {
+                first += step + 1;
+                count -= step + 1;
+            }
+            else
+            {
+                count = step;
+            }
+        }
+        return first;
+    }
+
+    //! @brief Number of records of the chunk starting at record first.
+    size_t get_chunk_length(const size_t first) const
+    {
+        return std::min(chunk_size_, num_records_ - first);
+    }
+
+    size_t get_offset(const size_t record, const size_t column) const
+    {
+        if (layout_ == RobotLogLayout::RECORDS)
+        {
+            return record * get_number_of_columns() + column;
+        }
+
+        const size_t first = record / chunk_size_ * chunk_size_;
+        return first * get_number_of_columns() +
+               column * get_chunk_length(first) + record - first;
+    }
+
+    void check_record(const size_t record) const
+    {
+        if (record >= num_records_)
+        {
+            throw std::out_of_range("Record " + std::to_string(record) +
+                                    " is not in the log.");
+        }
+    }
+
+    void check_column(const size_t column) const
+    {
+        if (column >= get_number_of_columns())
+        {
+            throw std::out_of_range("Column " + std::to_string(column) +
+                                    " is not in the log.");
+        }
+    }
+};
+
+}  // namespace robot_interfaces
@@ -10,6 +10,7 @@
 
 #include <fstream>
 #include <iostream>
+#include <memory>
 
 #include <chrono>
 
@@ -24,6 +25,7 @@
 #include <real_time_tools/timer.hpp>
 
 #include <robot_interfaces/loggable.hpp>
+#include <robot_interfaces/robot_log_file.hpp>
 #include <robot_interfaces/status.hpp>
 
 namespace robot_interfaces
@@ -36,6 +38,15 @@ namespace robot_interfaces
  * *must* derive from Loggable. Any further data structure can be logged
  * similarly, which derives from Loggable.
  *
+ * One line is logged per action.  If the robot data records more than one
+ * observation per action, only the observation at which the action is applied
+ * is logged.
+ *
+ * The log is written as text by default.  For long runs at high rates, the
+ * binary formats are much cheaper to write and to read (see RobotLogFormat
+ * and RobotBinaryLogWriter).  They contain the same columns as the text
+ * format, all values stored as double.
+ *
  * @tparam Action
  * @tparam Observation
  */
@@ -66,9 +77,11 @@ public:
     long int index_;
 
     bool stop_was_called_;
+    bool is_started_;
 
     std::ofstream output_file_;
     std::string output_file_name_;
+    RobotLogFormat format_;
 
     RobotLogger(
         std::shared_ptr<robot_interfaces::RobotData<Action, Observation>>
@@ -76,7 +89,10 @@ public:
         int block_size)
         : logger_data_(robot_data),
           block_size_(block_size),
-          stop_was_called_(false)
+          index_(0),
+          stop_was_called_(false),
+          is_started_(false),
+          format_(RobotLogFormat::TEXT)
     {
         thread_ = std::make_shared<real_time_tools::RealTimeThread>();
     }
@@ -179,50 +195,67 @@ public:
         output_file_.close();
     }
 
+    /**
+     * @brief Creates the binary log file and writes the header.
+     */
+    void open_binary_file()
+    {
+        std::vector<std::string> header = get_header();
+        // the "#" only marks the header line as comment in the text format
+        header[0] = "time_index";
+
+        binary_writer_ = std::make_shared<RobotBinaryLogWriter>(
+            output_file_name_,
+            header,
+            format_ == RobotLogFormat::BINARY ? RobotLogLayout::RECORDS
+                                              : RobotLogLayout::COLUMN_CHUNKS,
+            block_size_);
+    }
+
     /**
      * @brief Writes the timestamped robot data at
      * *hopefully* every time index to the log file.
      */
     void append_robot_data_to_file()
     {
-        output_file_.open(output_file_name_, std::ios_base::app);
-        output_file_.precision(27);
+        const bool is_text = format_ == RobotLogFormat::TEXT;
+        if (is_text)
+        {
+            output_file_.open(output_file_name_, std::ios_base::app);
+            output_file_.precision(27);
+        }
+        else if (!binary_writer_)
+        {
+            // binary file is closed already
+            return;
+        }
 
         for (long int j = index_;
-             j < std::min(index_ + block_size_,
-                          logger_data_->observation->newest_timeindex());
+             j < std::min(index_ + block_size_, newest_action_timeindex());
              j++)
         {
             try
             {
-                Action applied_action = (*logger_data_->applied_action)[j];
-                Action desired_action = (*logger_data_->desired_action)[j];
-                Observation observation = (*logger_data_->observation)[j];
-                Status status = (*logger_data_->status)[j];
+                fill_record(j);
 
-                std::vector<std::vector<double>> status_data =
-                    status.get_data();
-                std::vector<std::vector<double>> observation_data =
-                    observation.get_data();
-
-                std::vector<std::vector<double>> applied_action_data =
-                    applied_action.get_data();
-
-                std::vector<std::vector<double>> desired_action_data =
-                    desired_action.get_data();
-
-                output_file_ << j << " "
-                             << logger_data_->observation->timestamp_s(j)
-                             << " ";
-
-                append_field_data_to_file(status_data);
-                append_field_data_to_file(observation_data);
-                append_field_data_to_file(applied_action_data);
-                append_field_data_to_file(desired_action_data);
-
-                output_file_ << std::endl;
+                if (is_text)
+                {
+                    for (double value : record_)
+                    {
+                        output_file_ << value << " ";
+                    }
+                    output_file_ << std::endl;
+                }
+                else
+                {
+                    binary_writer_->append_record(record_.data());
+                }
+            }
+            catch (const std::length_error &e)
+            {
+                std::cout << "Skipping time index " << j << ": " << e.what()
+                          << std::endl;
             }
-
             catch (const std::exception &e)
             {
                 std::cout << "Trying to access index older than the "
@@ -231,25 +264,59 @@ public:
             }
         }
 
-        output_file_.close();
+        if (is_text)
+        {
+            output_file_.close();
+        }
     }
 
     /**
-     * @brief Appends the data corresponding to
-     * every field at the same time index to the log file.
+     * @brief Writes the values of time index j to record_.
      *
-     * @param field_data The field data
+     * The values are written directly to the record with
+     * Loggable::write_data(), so this does not allocate memory for them.
+     *
+     * @throws std::length_error if the number of values of the elements does
+     *     not match the header.
      */
-    void append_field_data_to_file(std::vector<std::vector<double>> field_data)
+    void fill_record(const long int j)
     {
-        std::ostream_iterator<double> double_iterator(output_file_, " ");
-
-        for (auto data : field_data)
+        const long int observations_per_action =
+            logger_data_->get_observations_per_action();
+
+        Action applied_action = (*logger_data_->applied_action)[j];
+        Action desired_action = (*logger_data_->desired_action)[j];
+        Observation observation =
+            (*logger_data_->observation)[j * observations_per_action];
+        Status status = (*logger_data_->status)[j];
+
+        double *const end = record_.data() + record_.size();
+        double *data = record_.data();
+        *data++ = j;
+        *data++ =
+            logger_data_->observation->timestamp_s(j * observations_per_action);
+        data += status.write_data(data, end - data);
+        data += observation.write_data(data, end - data);
+        data += applied_action.write_data(data, end - data);
+        data += desired_action.write_data(data, end - data);
+
+        if (data != end)
         {
-            std::copy(data.begin(), data.end(), double_iterator);
+            throw std::length_error(
+                "Number of values does not match the header.");
         }
     }
 
+    /**
+     * @brief Index of the action of the newest observation.
+     */
+    long int newest_action_timeindex() const
+    {
+        return logger_data_->observation->newest_timeindex() /
+               static_cast<long int>(
+                   logger_data_->get_observations_per_action());
+    }
+
     static void *write(void *instance_pointer)
     {
         ((RobotLogger *)(instance_pointer))->write();
@@ -264,7 +331,14 @@ public:
      */
     void write()
     {
-        append_header_to_file();
+        if (format_ == RobotLogFormat::TEXT)
+        {
+            append_header_to_file();
+        }
+        else
+        {
+            open_binary_file();
+        }
 
         while (!stop_was_called_ &&
                !(logger_data_->desired_action->length() > 0))
@@ -272,12 +346,11 @@ public:
             real_time_tools::Timer::sleep_until_sec(0.1);
         }
 
-        index_ = logger_data_->observation->newest_timeindex();
+        index_ = newest_action_timeindex();
 
         while (!stop_was_called_)
         {
-            if (index_ + block_size_ <=
-                logger_data_->observation->newest_timeindex())
+            if (index_ + block_size_ <= newest_action_timeindex())
             {
 #ifdef VERBOSE
                 auto t1 = std::chrono::high_resolution_clock::now();
@@ -321,26 +394,55 @@ public:
      * problem. But for different log files, specify different file names while
      * starting the logger.
      *
+     * In the binary formats, an existing file is overwritten instead.
+     *
      * @param filename The name of the log file.
+     * @param format Format of the log file.
      */
-    void start(std::string filename)
+    void start(std::string filename,
+               RobotLogFormat format = RobotLogFormat::TEXT)
     {
         output_file_name_ = filename;
+        format_ = format;
+        // the number of values is fixed, so the record is allocated only once
+        record_.resize(get_header().size());
+        is_started_ = true;
         thread_->create_realtime_thread(&RobotLogger::write, this);
     }
 
     /**
      * @brief Call stop() when you want to stop logging.
+     *
+     * All time indices that were not logged yet are written before the file
+     * is closed.  Does nothing if the logger was not started.
      */
     void stop()
     {
         stop_was_called_ = true;
+        if (!is_started_)
+        {
+            return;
+        }
+        is_started_ = false;
+
         thread_->join();
-        append_robot_data_to_file();
+        // the thread may lag behind by more than one block
+        while (index_ < newest_action_timeindex())
+        {
+            append_robot_data_to_file();
+            index_ += block_size_;
+        }
+
+        // closes the binary file
+        binary_writer_.reset();
     }
 
 private:
     std::shared_ptr<real_time_tools::RealTimeThread> thread_;
+
+    std::shared_ptr<RobotBinaryLogWriter> binary_writer_;
+    //! @brief Values of the time index that is written, see fill_record().
+    std::vector<double> record_;
 };
 
 }  // namespace robot_interfaces
@@ -6,7 +6,10 @@
  * @license BSD 3-clause
  */
 
+#include <limits>
+
 #include <pybind11/eigen.h>
+#include <pybind11/functional.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
@@ -65,7 +68,32 @@ void create_sensor_bindings(pybind11::module& m)
         .def("get_timestamp_ms",
              &SensorFrontend<ObservationType>::get_timestamp_ms)
         .def("get_current_timeindex",
-             &SensorFrontend<ObservationType>::get_current_timeindex);
+             &SensorFrontend<ObservationType>::get_current_timeindex)
+        .def("wait_until_timeindex",
+             &SensorFrontend<ObservationType>::wait_until_timeindex,
+             pybind11::arg("t"),
+             pybind11::arg("max_duration_s") =
+                 std::numeric_limits<double>::infinity(),
+             pybind11::call_guard<pybind11::gil_scoped_release>())
+        .def("try_wait_until_timeindex",
+             &SensorFrontend<ObservationType>::try_wait_until_timeindex)
+        .def("wait_for_any_newer_than",
+             &SensorFrontend<ObservationType>::wait_for_any_newer_than,
+             pybind11::arg("t"),
+             pybind11::arg("max_duration_s") =
+                 std::numeric_limits<double>::infinity(),
+             pybind11::call_guard<pybind11::gil_scoped_release>())
+        .def("subscribe_observations",
+             &SensorFrontend<ObservationType>::subscribe_observations,
+             pybind11::arg("callback"),
+             pybind11::call_guard<pybind11::gil_scoped_release>())
+        .def("unsubscribe_observations",
+             &SensorFrontend<ObservationType>::unsubscribe_observations,
+             pybind11::arg("subscription_id"),
+             pybind11::call_guard<pybind11::gil_scoped_release>())
+        .def("get_observation_event_fd",
+             &SensorFrontend<ObservationType>::get_observation_event_fd,
+             pybind11::call_guard<pybind11::gil_scoped_release>());
 
     pybind11::class_<Logger, std::shared_ptr<Logger>>(m, "Logger")
         .def(pybind11::init<typename std::shared_ptr<BaseData>, size_t>())
@@ -11,9 +11,12 @@
 
 #include <algorithm>
 #include <cmath>
+#include <limits>
+#include <utility>
 
 #include <time_series/time_series.hpp>
 
+#include <robot_interfaces/observation_dispatcher.hpp>
 #include <robot_interfaces/sensors/sensor_data.hpp>
 
 namespace robot_interfaces
@@ -34,9 +37,12 @@ public:
     using Timeseries = time_series::TimeSeries<Type>;
     typedef time_series::Timestamp TimeStamp;
     typedef time_series::Index TimeIndex;
+    typedef ObservationDispatcher<ObservationType> Dispatcher;
 
     SensorFrontend(std::shared_ptr<SensorData<ObservationType>> sensor_data)
-        : sensor_data_(sensor_data)
+        : sensor_data_(sensor_data),
+          observation_dispatcher_(
+              std::make_shared<Dispatcher>(sensor_data->observation))
     {
     }
 
@@ -45,6 +51,19 @@ public:
         return (*sensor_data_->observation)[t];
     }
 
+    /**
+     * @brief Call a function with the observation of time index t.
+     *
+     * See RobotFrontend::with_observation().
+     */
+    template <typename Visitor>
+    auto with_observation(const TimeIndex t, Visitor visitor) const
+        -> decltype(visitor(std::declval<const ObservationType &>()))
+    {
+        const ObservationType observation = (*sensor_data_->observation)[t];
+        return visitor(observation);
+    }
+
     ObservationType get_latest_observation() const
     {
         return sensor_data_->observation->newest_element();
@@ -59,8 +78,88 @@ public:
         return sensor_data_->observation->newest_timeindex();
     }
 
+    /**
+     * @brief Wait until the observation with index t is available or the
+     *     timeout expires.
+     *
+     * @param t  Observation index to wait for.
+     * @param max_duration_s  Maximum time to wait.  Set to infinity to wait
+     *     without timeout.
+     * @return True if the observation is available, false if the timeout
+     *     expired.
+     */
+    bool wait_until_timeindex(const TimeIndex t,
+                              const double max_duration_s =
+                                  std::numeric_limits<double>::infinity()) const
+    {
+        if (std::isinf(max_duration_s))
+        {
+            // the time series waits without timeout if none is given
+            return sensor_data_->observation->wait_for_timeindex(t);
+        }
+        return sensor_data_->observation->wait_for_timeindex(t,
+                                                             max_duration_s);
+    }
+
+    /**
+     * @brief Check if the observation with index t is available, without
+     *     blocking.
+     */
+    bool try_wait_until_timeindex(const TimeIndex t) const
+    {
+        return sensor_data_->observation->newest_timeindex(false) >= t;
+    }
+
+    /**
+     * @brief Wait until there is an observation newer than t.
+     *
+     * @param t  Observation index.  Pass time_series::EMPTY to wait for the
+     *     first observation.
+     * @param max_duration_s  Maximum time to wait.  Set to infinity to wait
+     *     without timeout.
+     * @return Index of the newest observation.  Only greater than t if there
+     *     is a newer observation, i.e. not if the timeout expired.
+     */
+    TimeIndex wait_for_any_newer_than(
+        const TimeIndex t,
+        const double max_duration_s =
+            std::numeric_limits<double>::infinity()) const
+    {
+        wait_until_timeindex(t + 1, max_duration_s);
+        return sensor_data_->observation->newest_timeindex(false);
+    }
+
+    /**
+     * @brief Subscribe to new observations.
+     *
+     * See RobotFrontend::subscribe_observations().
+     */
+    typename Dispatcher::SubscriptionId subscribe_observations(
+        const typename Dispatcher::Callback &callback)
+    {
+        return observation_dispatcher_->subscribe(callback);
+    }
+
+    /**
+     * @brief Get a file descriptor that is signalled on new observations.
+     *
+     * See RobotFrontend::get_observation_event_fd().
+     */
+    int get_observation_event_fd()
+    {
+        return observation_dispatcher_->get_event_fd();
+    }
+
+    //! @brief Cancel a subscription made with subscribe_observations().
+    void unsubscribe_observations(
+        const typename Dispatcher::SubscriptionId &subscription_id)
+    {
+        observation_dispatcher_->unsubscribe(subscription_id);
+    }
+
 private:
     std::shared_ptr<SensorData<ObservationType>> sensor_data_;
+    std::shared_ptr<Dispatcher> observation_dispatcher_;
 };
 
 }  // namespace robot_interfaces
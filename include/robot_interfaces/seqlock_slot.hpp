@@ -0,0 +1,298 @@
+/**
+ * @file
+ * @brief Slots of serialized data that are protected by a sequence number.
+ * @copyright 2020, Max Planck Gesellschaft. All rights reserved.
+ * @license BSD 3-clause
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <istream>
+#include <new>
+#include <ostream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <cereal/archives/binary.hpp>
+
+#include "wait_strategy.hpp"
+
+namespace robot_interfaces
+{
+namespace internal
+{
+//! @brief Stream buffer writing to a fixed-size array (no allocations).
+class ArrayOutputStreamBuffer : public std::streambuf
+{
+public:
+    ArrayOutputStreamBuffer(char *data, size_t size)
+    {
+        setp(data, data + size);
+    }
+
+    //! @brief Number of bytes written so far.
+    size_t size() const
+    {
+        return pptr() - pbase();
+    }
+};
+
+//! @brief Stream buffer reading from a fixed-size array.
+class ArrayInputStreamBuffer : public std::streambuf
+{
+public:
+    ArrayInputStreamBuffer(const char *data, size_t size)
+    {
+        // the get area is never written, so casting away const is safe
+        char *begin = const_cast<char *>(data);
+        setg(begin, begin, begin + size);
+    }
+};
+
+//! @brief Shared memory object together with its mapping.
+struct SharedMemoryMapping
+{
+    boost::interprocess::shared_memory_object object;
+    boost::interprocess::mapped_region region;
+};
+
+/**
+ * @brief Header of a slot holding one serialized element.
+ *
+ * The serialized data follows directly after the header.  A slot has a
+ * single writer and any number of readers.  The writer makes the sequence
+ * number odd before changing the slot and even again afterwards.  Readers
+ * copy the slot and retry if the sequence number was odd or changed in the
+ * meantime ("seqlock").  This way, readers never delay the writer.
+ *
+ * Use SeqlockSlotWriter and read_seqlock_slot() to access slots.
+ */
+struct SeqlockSlotHeader
+{
+    //! @brief Odd while the slot is written, incremented twice per write.
+    std::atomic<uint64_t> sequence;
+    //! @brief Index of the stored element (negative if there is none).
+    std::atomic<int64_t> index;
+    //! @brief Size of the serialized data in bytes.
+    std::atomic<uint64_t> data_size;
+    //! @brief Time stamp of the element.  Meaning depends on the user.
+    std::atomic<double> timestamp;
+
+    SeqlockSlotHeader() : sequence(0), index(-1), data_size(0), timestamp(0)
+    {
+    }
+
+    char *get_data()
+    {
+        return reinterpret_cast<char *>(this) + sizeof(SeqlockSlotHeader);
+    }
+
+    const char *get_data() const
+    {
+        return reinterpret_cast<const char *>(this) +
+               sizeof(SeqlockSlotHeader);
+    }
+
+    //! @brief Round a size up so that slot headers placed after it are
+    //! aligned.
+    static size_t align(const size_t size)
+    {
+        const size_t alignment = alignof(SeqlockSlotHeader);
+        return (size + alignment - 1) / alignment * alignment;
+    }
+
+    //! @brief Distance between consecutive slots of the given data size.
+    static size_t get_stride(const size_t slot_size)
+    {
+        return align(sizeof(SeqlockSlotHeader) + slot_size);
+    }
+};
+
+/**
+ * @brief Slot size for elements of type T if none is specified.
+ *
+ * Twice the serialized size of a default-constructed T (to leave room for
+ * types of variable size), but at least 1 kB.
+ */
+template <typename T>
+size_t get_default_slot_size()
+{
+    std::ostringstream stream;
+    {
+        cereal::BinaryOutputArchive archive(stream);
+        archive(T());
+    }
+    return std::max<size_t>(2 * stream.str().size(), 1024);
+}
+
+/**
+ * @brief Writes elements to slots.
+ *
+ * Elements are serialized with cereal into a preallocated buffer first and
+ * then copied to the slot, so writing does not allocate memory and the slot
+ * is only locked for the copy.
+ */
+class SeqlockSlotWriter
+{
+public:
+    //! @param slot_size  Maximum size of a serialized element in bytes.
+    explicit SeqlockSlotWriter(const size_t slot_size)
+        : serialization_buffer_(slot_size)
+    {
+    }
+
+    /**
+     * @brief Write an element to a slot.
+     *
+     * Must not be called concurrently for the same slot.
+     *
+     * @return False if the serialized element does not fit into the slot.  In
+     *     this case the slot is not changed.
+     */
+    template <typename T>
+    bool write(SeqlockSlotHeader *slot,
+               const int64_t index,
+               const double timestamp,
+               const T &value)
+    {
+        ArrayOutputStreamBuffer stream_buffer(serialization_buffer_.data(),
+                                              serialization_buffer_.size());
+        std::ostream stream(&stream_buffer);
+        try
+        {
+            cereal::BinaryOutputArchive archive(stream);
+            archive(value);
+        }
+        catch (const std::exception &)
+        {
+            // cereal throws if the stream is full
+            stream.setstate(std::ios::badbit);
+        }
+        if (!stream.good())
+        {
+            return false;
+        }
+
+        write_raw(slot, index, timestamp, stream_buffer.size());
+        return true;
+    }
+
+    //! @brief Mark a slot as empty.
+    void clear(SeqlockSlotHeader *slot)
+    {
+        write_raw(slot, -1, 0, 0);
+    }
+
+private:
+    std::vector<char> serialization_buffer_;
+
+    void write_raw(SeqlockSlotHeader *slot,
+                   const int64_t index,
+                   const double timestamp,
+                   const size_t data_size)
+    {
+        const uint64_t sequence = slot->sequence.load(std::memory_order_relaxed);
+        slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        slot->index.store(index, std::memory_order_relaxed);
+        slot->data_size.store(data_size, std::memory_order_relaxed);
+        slot->timestamp.store(timestamp, std::memory_order_relaxed);
+        std::memcpy(slot->get_data(), serialization_buffer_.data(), data_size);
+
+        slot->sequence.store(sequence + 2, std::memory_order_release);
+    }
+};
+
+/**
+ * @brief Read the element of a slot.
+ *
+ * Never blocks the writer.  If the slot is written concurrently, the read is
+ * repeated.  The slot is copied to the given buffer, so this does not
+ * allocate memory (unless the deserialization of T does).
+ *
+ * @param slot  The slot.
+ * @param buffer  Buffer for the serialized element.  Its size is the maximum
+ *     size of serialized elements in the slot.
+ * @param value  Set to the element if the slot contains one.
+ * @param index  Set to the index of the element (negative if there is none).
+ * @param timestamp  If not null, set to the time stamp of the element.
+ *
+ * @return False if the slot is empty.
+ */
+template <typename T>
+bool read_seqlock_slot(const SeqlockSlotHeader *slot,
+                       std::vector<char> &buffer,
+                       T &value,
+                       int64_t &index,
+                       double *timestamp = nullptr)
+{
+    uint64_t data_size;
+    double slot_timestamp;
+
+    // copy the slot until it was not changed while copying
+    while (true)
+    {
+        const uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        if (sequence % 2 == 1)
+        {
+            cpu_relax();
+            continue;
+        }
+
+        index = slot->index.load(std::memory_order_relaxed);
+        data_size = std::min<uint64_t>(
+            slot->data_size.load(std::memory_order_relaxed), buffer.size());
+        slot_timestamp = slot->timestamp.load(std::memory_order_relaxed);
+        std::memcpy(buffer.data(), slot->get_data(), data_size);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot->sequence.load(std::memory_order_relaxed) == sequence)
+        {
+            break;
+        }
+    }
+
+    if (index < 0)
+    {
+        return false;
+    }
+
+    ArrayInputStreamBuffer stream_buffer(buffer.data(), data_size);
+    std::istream stream(&stream_buffer);
+    cereal::BinaryInputArchive archive(stream);
+    archive(value);
+
+    if (timestamp)
+    {
+        *timestamp = slot_timestamp;
+    }
+    return true;
+}
+
+/**
+ * @brief Like read_seqlock_slot() above but with a temporary buffer.
+ *
+ * @param slot_size  Maximum size of serialized elements in the slot.
+ */
+template <typename T>
+bool read_seqlock_slot(const SeqlockSlotHeader *slot,
+                       const size_t slot_size,
+                       T &value,
+                       int64_t &index,
+                       double *timestamp = nullptr)
+{
+    std::vector<char> buffer(slot_size);
+    return read_seqlock_slot(slot, buffer, value, index, timestamp);
+}
+
+}  // namespace internal
+}  // namespace robot_interfaces
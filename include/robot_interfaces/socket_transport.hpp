@@ -0,0 +1,638 @@
+/**
+ * @file
+ * @brief Binary message transport over TCP sockets.
+ * @copyright 2020, Max Planck Gesellschaft. All rights reserved.
+ * @license BSD 3-clause
+ */
+#pragma once
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <cereal/archives/binary.hpp>
+
+#include "seqlock_slot.hpp"
+
+namespace robot_interfaces
+{
+/**
+ * @brief Statistics of a connection of the socket transport.
+ *
+ * Latencies are estimated as half of the round trip time of a message and
+ * its acknowledgement, so they do not depend on synchronised clocks.
+ */
+struct TransportStatistics
+{
+    //! @brief Number of messages sent.
+    uint64_t messages_sent = 0;
+    //! @brief Number of messages received.
+    uint64_t messages_received = 0;
+    //! @brief Number of messages missing in the sequence of received ones.
+    uint64_t messages_lost = 0;
+    //! @brief Number of sent messages that are not acknowledged (yet).
+    uint64_t messages_unacknowledged = 0;
+    //! @brief Number of elements (actions, observations, ...) sent.
+    uint64_t elements_sent = 0;
+    //! @brief Number of elements received.
+    uint64_t elements_received = 0;
+    //! @brief Latency of the most recently acknowledged message.
+    double last_latency_s = 0;
+    //! @brief Mean latency of all acknowledged messages.
+    double mean_latency_s = 0;
+    //! @brief Maximum latency of all acknowledged messages.
+    double max_latency_s = 0;
+};
+
+namespace internal
+{
+//! @brief Type of a message, determines the content of the payload.
+enum class MessageType : uint32_t
+{
+    //! @brief Sent by the server after connecting, see RemoteRobotBridge.
+    HELLO = 1,
+    //! @brief Acknowledges a received message (sent automatically).
+    ACKNOWLEDGE,
+    DESIRED_ACTION,
+    APPLIED_ACTION,
+    OBSERVATION,
+    STATUS
+};
+
+/**
+ * @brief Header preceding each message on the wire.
+ *
+ * Fields are sent in host byte order, so both ends need the same endianness.
+ */
+struct MessageHeader
+{
+    uint32_t magic;
+    uint32_t type;
+    //! @brief Per-connection sequence number, incremented for each message
+    //! except acknowledgements.
+    uint64_t sequence;
+    //! @brief Send time on the steady clock of the sender.
+    int64_t send_time_ns;
+    //! @brief Number of elements batched in the payload.
+    uint32_t num_elements;
+    uint32_t payload_size;
+
+    //! @brief Identifies the protocol (and its version).
+    static constexpr uint32_t MAGIC = 0x52494231;  // "RIB1"
+
+    /**
+     * @brief Maximum size of the payload of a message.
+     *
+     * Messages with a larger payload are rejected, so that a broken or
+     * malicious peer cannot make the receiver allocate arbitrary amounts of
+     * memory.
+     */
+    static constexpr uint32_t MAX_PAYLOAD_SIZE = 64 << 20;
+};
+
+//! @brief A received message.
+struct Message
+{
+    MessageType type;
+    uint64_t sequence;
+    uint32_t num_elements;
+    std::vector<char> payload;
+};
+
+inline int64_t get_steady_time_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+inline std::runtime_error socket_error(const std::string &what)
+{
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+/**
+ * @brief Batch of time-indexed elements to be sent in one message.
+ *
+ * Each element is stored as its time index (int64), the size of the
+ * serialized element (uint32) and the element serialized with the binary
+ * archive of cereal.
+ */
+class ElementBatch
+{
+public:
+    /**
+     * @brief Size of the data at which a batch should be sent, even if more
+     *     elements are pending.
+     *
+     * Keeps batches well below MessageHeader::MAX_PAYLOAD_SIZE when a long
+     * history is sent at once.
+     */
+    static constexpr size_t TARGET_SIZE = 1 << 20;
+
+    //! @brief Number of bytes stored per element in addition to its data.
+    static constexpr size_t ELEMENT_OVERHEAD =
+        sizeof(int64_t) + sizeof(uint32_t);
+
+    template <typename T>
+    void add(const int64_t timeindex, const T &element)
+    {
+        stream_.str(std::string());
+        {
+            cereal::BinaryOutputArchive archive(stream_);
+            archive(element);
+        }
+        const std::string serialized = stream_.str();
+        const uint32_t size = serialized.size();
+
+        append(&timeindex, sizeof(timeindex));
+        append(&size, sizeof(size));
+        append(serialized.data(), size);
+        num_elements_++;
+    }
+
+    void clear()
+    {
+        data_.clear();
+        num_elements_ = 0;
+    }
+
+    const std::vector<char> &get_data() const
+    {
+        return data_;
+    }
+
+    uint32_t get_number_of_elements() const
+    {
+        return num_elements_;
+    }
+
+    //! @brief Check if the batch reached TARGET_SIZE.
+    bool is_full() const
+    {
+        return data_.size() >= TARGET_SIZE;
+    }
+
+private:
+    std::vector<char> data_;
+    uint32_t num_elements_ = 0;
+    std::ostringstream stream_;
+
+    void append(const void *data, const size_t size)
+    {
+        const char *begin = static_cast<const char *>(data);
+        data_.insert(data_.end(), begin, begin + size);
+    }
+};
+
+/**
+ * @brief Call a function for each element of a message.
+ *
+ * @param message  Message with a payload created by ElementBatch.
+ * @param callback  Called with the time index and the element.
+ * @throws std::runtime_error if the payload is malformed.
+ */
+template <typename T, typename Callback>
+void for_each_element(const Message &message, Callback callback)
+{
+    const char *data = message.payload.data();
+    const char *const end = data + message.payload.size();
+
+    for (uint32_t i = 0; i < message.num_elements; i++)
+    {
+        int64_t timeindex;
+        uint32_t size;
+        if (end - data < static_cast<long>(sizeof(timeindex) + sizeof(size)))
+        {
+            throw std::runtime_error("Malformed message.");
+        }
+        std::memcpy(&timeindex, data, sizeof(timeindex));
+        data += sizeof(timeindex);
+        std::memcpy(&size, data, sizeof(size));
+        data += sizeof(size);
+        if (end - data < static_cast<long>(size))
+        {
+            throw std::runtime_error("Malformed message.");
+        }
+
+        T element;
+        {
+            ArrayInputStreamBuffer stream_buffer(data, size);
+            std::istream stream(&stream_buffer);
+            cereal::BinaryInputArchive archive(stream);
+            archive(element);
+        }
+        data += size;
+
+        callback(timeindex, element);
+    }
+}
+
+/**
+ * @brief Connection for exchanging messages over a TCP socket.
+ *
+ * Every received message is acknowledged automatically, which is used by the
+ * sender to measure the latency.  Gaps in the sequence numbers of received
+ * messages are counted as lost messages.
+ *
+ * send() can be called from any thread, receive() must only be called from
+ * one thread at a time.  Acknowledgements are only processed while
+ * receive() is called.
+ */
+class SocketConnection
+{
+public:
+    //! @param socket  Connected socket, the connection takes ownership.
+    explicit SocketConnection(const int socket) : socket_(socket)
+    {
+        // messages are batched already, so send them right away
+        const int flag = 1;
+        setsockopt(socket_, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    }
+
+    ~SocketConnection()
+    {
+        ::close(socket_);
+    }
+
+    SocketConnection(const SocketConnection &) = delete;
+    SocketConnection &operator=(const SocketConnection &) = delete;
+
+    /**
+     * @brief Send a message.
+     *
+     * @return False if the connection is closed.
+     * @throws std::invalid_argument if the payload is larger than
+     *     MessageHeader::MAX_PAYLOAD_SIZE.
+     */
+    bool send(const MessageType type,
+              const std::vector<char> &payload = std::vector<char>(),
+              const uint32_t num_elements = 0)
+    {
+        if (payload.size() > MessageHeader::MAX_PAYLOAD_SIZE)
+        {
+            throw std::invalid_argument(
+                "Payload of " + std::to_string(payload.size()) +
+                " bytes exceeds the maximum message size.");
+        }
+
+        std::lock_guard<std::mutex> lock(send_mutex_);
+
+        MessageHeader header;
+        header.magic = MessageHeader::MAGIC;
+        header.type = static_cast<uint32_t>(type);
+        header.sequence = next_sequence_;
+        header.num_elements = num_elements;
+        header.payload_size = payload.size();
+        header.send_time_ns = get_steady_time_ns();
+
+        // header and payload in one buffer, so they are sent in one go
+        send_buffer_.resize(sizeof(header) + payload.size());
+        std::memcpy(send_buffer_.data(), &header, sizeof(header));
+        std::copy(payload.begin(),
+                  payload.end(),
+                  send_buffer_.begin() + sizeof(header));
+        if (!write_all(send_buffer_.data(), send_buffer_.size()))
+        {
+            return false;
+        }
+
+        // acknowledgements are not acknowledged themselves, so they are not
+        // part of the sequence either
+        if (type != MessageType::ACKNOWLEDGE)
+        {
+            next_sequence_++;
+            std::lock_guard<std::mutex> statistics_lock(statistics_mutex_);
+            statistics_.messages_sent++;
+            statistics_.messages_unacknowledged++;
+            statistics_.elements_sent += num_elements;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Receive the next message.
+     *
+     * Blocks until a message is received.  Acknowledgements are handled
+     * internally and not returned.
+     *
+     * @return False if the connection is closed.
+     * @throws std::runtime_error if the received data is not a valid message
+     *     (including unknown message types and payloads that exceed
+     *     MessageHeader::MAX_PAYLOAD_SIZE or cannot hold the announced
+     *     number of elements).
+     */
+    bool receive(Message &message)
+    {
+        while (true)
+        {
+            MessageHeader header;
+            if (!read_all(&header, sizeof(header)))
+            {
+                return false;
+            }
+            // validate before allocating anything based on the header
+            if (header.magic != MessageHeader::MAGIC ||
+                header.type < static_cast<uint32_t>(MessageType::HELLO) ||
+                header.type > static_cast<uint32_t>(MessageType::STATUS) ||
+                header.payload_size > MessageHeader::MAX_PAYLOAD_SIZE ||
+                header.num_elements >
+                    header.payload_size / ElementBatch::ELEMENT_OVERHEAD)
+            {
+                throw std::runtime_error("Received invalid message.");
+            }
+
+            message.type = static_cast<MessageType>(header.type);
+            message.sequence = header.sequence;
+            message.num_elements = header.num_elements;
+            message.payload.resize(header.payload_size);
+            if (!read_all(message.payload.data(), header.payload_size))
+            {
+                return false;
+            }
+
+            if (message.type == MessageType::ACKNOWLEDGE)
+            {
+                handle_acknowledge(message);
+                continue;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(statistics_mutex_);
+                statistics_.messages_received++;
+                statistics_.elements_received += header.num_elements;
+                if (header.sequence > next_expected_sequence_)
+                {
+                    statistics_.messages_lost +=
+                        header.sequence - next_expected_sequence_;
+                }
+                next_expected_sequence_ = header.sequence + 1;
+            }
+
+            // echo sequence number and send time, see handle_acknowledge()
+            std::vector<char> acknowledge(sizeof(header.sequence) +
+                                          sizeof(header.send_time_ns));
+            std::memcpy(
+                acknowledge.data(), &header.sequence, sizeof(header.sequence));
+            std::memcpy(acknowledge.data() + sizeof(header.sequence),
+                        &header.send_time_ns,
+                        sizeof(header.send_time_ns));
+            send(MessageType::ACKNOWLEDGE, acknowledge);
+
+            return true;
+        }
+    }
+
+    /**
+     * @brief Shut the connection down.
+     *
+     * Unblocks receive() and makes further sends fail.  Can be called from
+     * any thread.
+     */
+    void shutdown()
+    {
+        ::shutdown(socket_, SHUT_RDWR);
+    }
+
+    TransportStatistics get_statistics() const
+    {
+        std::lock_guard<std::mutex> lock(statistics_mutex_);
+        return statistics_;
+    }
+
+private:
+    const int socket_;
+
+    std::mutex send_mutex_;
+    uint64_t next_sequence_ = 0;
+    std::vector<char> send_buffer_;
+
+    uint64_t next_expected_sequence_ = 0;
+    uint64_t num_latency_samples_ = 0;
+
+    mutable std::mutex statistics_mutex_;
+    TransportStatistics statistics_;
+
+    void handle_acknowledge(const Message &message)
+    {
+        int64_t send_time_ns;
+        if (message.payload.size() < sizeof(uint64_t) + sizeof(send_time_ns))
+        {
+            throw std::runtime_error("Malformed acknowledgement.");
+        }
+        std::memcpy(&send_time_ns,
+                    message.payload.data() + sizeof(uint64_t),
+                    sizeof(send_time_ns));
+
+        const double latency_s =
+            (get_steady_time_ns() - send_time_ns) * 1e-9 / 2;
+
+        std::lock_guard<std::mutex> lock(statistics_mutex_);
+        num_latency_samples_++;
+        statistics_.messages_unacknowledged--;
+        statistics_.last_latency_s = latency_s;
+        statistics_.max_latency_s =
+            std::max(statistics_.max_latency_s, latency_s);
+        statistics_.mean_latency_s +=
+            (latency_s - statistics_.mean_latency_s) / num_latency_samples_;
+    }
+
+    bool write_all(const char *data, size_t size)
+    {
+        while (size > 0)
+        {
+            const ssize_t n = ::send(socket_, data, size, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n <= 0)
+            {
+                return false;
+            }
+            data += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    bool read_all(void *buffer, size_t size)
+    {
+        char *data = static_cast<char *>(buffer);
+        while (size > 0)
+        {
+            const ssize_t n = ::recv(socket_, data, size, 0);
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n <= 0)
+            {
+                return false;
+            }
+            data += n;
+            size -= n;
+        }
+        return true;
+    }
+};
+
+/**
+ * @brief Connect to a TCP server.
+ *
+ * @param host  Host name or address of the server.
+ * @param port  Port of the server.
+ * @throws std::runtime_error if the connection fails.
+ */
+inline std::shared_ptr<SocketConnection> connect_tcp(const std::string &host,
+                                                     const uint16_t port)
+{
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo *addresses;
+    const int result = getaddrinfo(
+        host.c_str(), std::to_string(port).c_str(), &hints, &addresses);
+    if (result != 0)
+    {
+        throw std::runtime_error("Failed to resolve " + host + ": " +
+                                 gai_strerror(result));
+    }
+
+    int socket_fd = -1;
+    for (addrinfo *address = addresses; address; address = address->ai_next)
+    {
+        socket_fd = ::socket(address->ai_family,
+                             address->ai_socktype | SOCK_CLOEXEC,
+                             address->ai_protocol);
+        if (socket_fd < 0)
+        {
+            continue;
+        }
+        if (::connect(socket_fd, address->ai_addr, address->ai_addrlen) == 0)
+        {
+            break;
+        }
+        ::close(socket_fd);
+        socket_fd = -1;
+    }
+    freeaddrinfo(addresses);
+
+    if (socket_fd < 0)
+    {
+        throw socket_error("Failed to connect to " + host + ":" +
+                           std::to_string(port));
+    }
+    return std::make_shared<SocketConnection>(socket_fd);
+}
+
+//! @brief Socket listening for TCP connections.
+class TcpListener
+{
+public:
+    /**
+     * @param port  Port to listen on.  If zero, a free port is chosen (see
+     *     get_port()).
+     * @param loopback_only  If true, only accept connections from the local
+     *     host.
+     * @throws std::runtime_error if the socket cannot be bound.
+     */
+    TcpListener(const uint16_t port, const bool loopback_only)
+    {
+        socket_ = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (socket_ < 0)
+        {
+            throw socket_error("Failed to create socket");
+        }
+        const int flag = 1;
+        setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+
+        sockaddr_in address;
+        std::memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr =
+            htonl(loopback_only ? INADDR_LOOPBACK : INADDR_ANY);
+        socklen_t address_length = sizeof(address);
+
+        if (::bind(socket_,
+                   reinterpret_cast<sockaddr *>(&address),
+                   address_length) != 0 ||
+            ::listen(socket_, 1) != 0 ||
+            getsockname(socket_,
+                        reinterpret_cast<sockaddr *>(&address),
+                        &address_length) != 0)
+        {
+            const std::runtime_error error = socket_error(
+                "Failed to listen on port " + std::to_string(port));
+            ::close(socket_);
+            throw error;
+        }
+        port_ = ntohs(address.sin_port);
+    }
+
+    ~TcpListener()
+    {
+        ::close(socket_);
+    }
+
+    TcpListener(const TcpListener &) = delete;
+    TcpListener &operator=(const TcpListener &) = delete;
+
+    uint16_t get_port() const
+    {
+        return port_;
+    }
+
+    /**
+     * @brief Wait for a client to connect.
+     *
+     * @return The connection or null if the listener was shut down.
+     */
+    std::shared_ptr<SocketConnection> accept()
+    {
+        while (true)
+        {
+            const int socket_fd =
+                ::accept4(socket_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (socket_fd >= 0)
+            {
+                return std::make_shared<SocketConnection>(socket_fd);
+            }
+            if (errno != EINTR && errno != ECONNABORTED)
+            {
+                return nullptr;
+            }
+        }
+    }
+
+    //! @brief Stop listening, unblocks accept().
+    void shutdown()
+    {
+        ::shutdown(socket_, SHUT_RDWR);
+    }
+
+private:
+    int socket_;
+    uint16_t port_;
+};
+
+}  // namespace internal
+}  // namespace robot_interfaces
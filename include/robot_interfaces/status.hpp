@@ -13,21 +13,72 @@
 
 #pragma once
 
-#include <cereal/types/string.hpp>
-
-#include <robot_interfaces/loggable.hpp>
+#include <cstdint>
 #include <string>
+#include <type_traits>
 #include <vector>
 
+#include <cereal/types/string.hpp>
+
+#include <robot_interfaces/loggable_serialization.hpp>
+
 namespace robot_interfaces
 {
+/**
+ * @brief Timing information of a step of the backend loop.
+ *
+ * A step covers everything the backend does for one action, i.e. getting the
+ * observation, waiting for the action and applying it.  All durations are in
+ * seconds.
+ *
+ * This is a plain, trivially copyable struct, so it is cheap to pass around and
+ * to store.
+ */
+struct StepTiming
+{
+    /**
+     * @brief Whether the step took longer than the maximum step duration.
+     *
+     * See RobotBackend::set_max_step_duration().
+     */
+    bool overrun = false;
+
+    //! @brief Number of overruns since the backend was started.
+    uint32_t overrun_count = 0;
+
+    //! @brief Duration of the step.
+    double step_duration_s = 0;
+
+    //! @brief Maximum step duration since the backend was started.
+    double max_step_duration_s = 0;
+
+    //! @brief Duration of the RobotDriver::get_latest_observation() call.
+    double get_observation_duration_s = 0;
+
+    //! @brief Duration of the RobotDriver::apply_action() call.
+    double apply_action_duration_s = 0;
+
+    template <class Archive>
+    void serialize(Archive& archive)
+    {
+        archive(CEREAL_NVP(overrun),
+                CEREAL_NVP(overrun_count),
+                CEREAL_NVP(step_duration_s),
+                CEREAL_NVP(max_step_duration_s),
+                CEREAL_NVP(get_observation_duration_s),
+                CEREAL_NVP(apply_action_duration_s));
+    }
+};
+static_assert(std::is_trivially_copyable<StepTiming>::value,
+              "StepTiming must be trivially copyable");
+
 /**
  * @brief Status information from the backend.
  *
  * This struct is used to report status information that is not directly
  * robot-related from the backend to the frontend.
  */
-struct Status : public Loggable
+struct Status : public SerializedLoggable<Status>
 {
     enum class ErrorStatus
     {
@@ -52,6 +103,14 @@ struct Status : public Loggable
      */
     std::string error_message;
 
+    /**
+     * @brief Timing of the previous step of the backend.
+     *
+     * The status with index t is written in the step of action t before the
+     * action is applied, so it contains the timing of step t - 1.
+     */
+    StepTiming timing;
+
     /**
      * @brief Set error.
      *
@@ -84,20 +143,10 @@ struct Status : public Loggable
     template <class Archive>
     void serialize(Archive& archive)
     {
-        archive(action_repetitions, error_status, error_message);
-    }
-
-    std::vector<std::string> get_name() override
-    {
-        return {"action_repetitions", "error_status"};
-    }
-
-    std::vector<std::vector<double>> get_data() override
-    {
-        // FIXME error message cannot be logged because only numeric types are
-        // supported
-        return {{static_cast<double>(action_repetitions)},
-                {static_cast<double>(error_status)}};
+        archive(CEREAL_NVP(action_repetitions),
+                CEREAL_NVP(error_status),
+                CEREAL_NVP(error_message),
+                CEREAL_NVP(timing));
     }
 };
 
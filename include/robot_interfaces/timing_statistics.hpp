@@ -0,0 +1,295 @@
+/**
+ * @file
+ * @brief Online statistics of the timing of action execution.
+ * @copyright 2020, Max Planck Gesellschaft. All rights reserved.
+ * @license BSD 3-clause
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace robot_interfaces
+{
+/**
+ * @brief Histogram of durations with logarithmic buckets.
+ *
+ * Bucket 0 counts durations below 1 µs, bucket i > 0 counts durations in
+ * [2^(i-1), 2^i) µs.  The last bucket also counts all longer durations.
+ */
+struct DurationHistogram
+{
+    static constexpr size_t NUM_BUCKETS = 32;
+
+    std::array<uint64_t, NUM_BUCKETS> counts;
+
+    //! @brief Total number of recorded durations.
+    uint64_t total_count = 0;
+    //! @brief Shortest recorded duration (infinity if there is none).
+    double min_s = std::numeric_limits<double>::infinity();
+    //! @brief Longest recorded duration (zero if there is none).
+    double max_s = 0;
+    //! @brief Sum of all recorded durations.
+    double sum_s = 0;
+
+    DurationHistogram()
+    {
+        counts.fill(0);
+    }
+
+    //! @brief Mean of the recorded durations (NaN if there is none).
+    double mean_s() const
+    {
+        return total_count == 0 ? std::numeric_limits<double>::quiet_NaN()
+                                : sum_s / total_count;
+    }
+
+    //! @brief Get the index of the bucket the given duration belongs to.
+    static size_t get_bucket(const double duration_s)
+    {
+        const double duration_us = duration_s * 1e6;
+        if (!(duration_us >= 1))
+        {
+            return 0;
+        }
+        const size_t bucket =
+            static_cast<size_t>(std::floor(std::log2(duration_us))) + 1;
+        return bucket < NUM_BUCKETS ? bucket : NUM_BUCKETS - 1;
+    }
+
+    //! @brief Get the (exclusive) upper bound of a bucket in seconds.
+    static double get_bucket_upper_bound_s(const size_t bucket)
+    {
+        if (bucket >= NUM_BUCKETS - 1)
+        {
+            return std::numeric_limits<double>::infinity();
+        }
+        return std::ldexp(1.0, static_cast<int>(bucket)) * 1e-6;
+    }
+};
+
+/**
+ * @brief Thresholds for the timing of a MonitoredRobotDriver.
+ *
+ * Given relative to the time budget of the corresponding duration (i.e. the
+ * maximum action duration or maximum inter-action duration).
+ */
+struct TimingThresholds
+{
+    /**
+     * @brief Durations above this fraction of the budget are counted as near
+     *     misses.
+     */
+    double warning_fraction = 0.8;
+
+    /**
+     * @brief Durations above this fraction of the budget shut the robot down.
+     *
+     * Durations above the budget but below this threshold are counted as
+     * overruns.  Must not be smaller than 1, i.e. the budget itself.
+     */
+    double hard_fraction = 1.0;
+};
+
+/**
+ * @brief Statistics about the timing of actions of a MonitoredRobotDriver.
+ *
+ * Near misses are durations that are within the budget but exceed the warning
+ * threshold, overruns are durations that exceed the budget but not the hard
+ * threshold (see TimingThresholds).  Durations exceeding the hard threshold
+ * shut the robot down and are therefore not recorded.
+ */
+struct ActionTimingStatistics
+{
+    //! @brief Durations of apply_action().
+    DurationHistogram action_duration;
+    //! @brief Durations between end of an action and start of the next one.
+    DurationHistogram inter_action_duration;
+
+    //! @brief Number of near misses of the maximum action duration.
+    uint64_t action_duration_near_misses = 0;
+    //! @brief Number of near misses of the maximum inter-action duration.
+    uint64_t inter_action_duration_near_misses = 0;
+
+    //! @brief Number of overruns of the maximum action duration.
+    uint64_t action_duration_overruns = 0;
+    //! @brief Number of overruns of the maximum inter-action duration.
+    uint64_t inter_action_duration_overruns = 0;
+};
+
+namespace internal
+{
+/**
+ * @brief Increment a counter that is only written by a single thread.
+ *
+ * Cheaper than fetch_add() as it needs no read-modify-write operation.
+ */
+inline void increment(std::atomic<uint64_t> &value)
+{
+    value.store(value.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+}
+
+/**
+ * @brief DurationHistogram that can be read while it is updated.
+ *
+ * All values are atomics, so get() can be called from any thread while a
+ * single thread calls add().  Since add() is only allowed from one thread, it
+ * does not need read-modify-write operations and is about as cheap as updating
+ * a plain DurationHistogram.  Note that get() does not take a consistent
+ * snapshot, i.e. values may be off by one event.
+ */
+class AtomicDurationHistogram
+{
+public:
+    AtomicDurationHistogram()
+        : total_count_(0),
+          min_s_(std::numeric_limits<double>::infinity()),
+          max_s_(0),
+          sum_s_(0)
+    {
+        for (auto &count : counts_)
+        {
+            count = 0;
+        }
+    }
+
+    //! @brief Record a duration.  Must only be called by one thread.
+    void add(const double duration_s)
+    {
+        increment(counts_[DurationHistogram::get_bucket(duration_s)]);
+        increment(total_count_);
+        if (duration_s < min_s_.load(std::memory_order_relaxed))
+        {
+            min_s_.store(duration_s, std::memory_order_relaxed);
+        }
+        if (duration_s > max_s_.load(std::memory_order_relaxed))
+        {
+            max_s_.store(duration_s, std::memory_order_relaxed);
+        }
+        sum_s_.store(sum_s_.load(std::memory_order_relaxed) + duration_s,
+                     std::memory_order_relaxed);
+    }
+
+    DurationHistogram get() const
+    {
+        DurationHistogram histogram;
+        for (size_t i = 0; i < DurationHistogram::NUM_BUCKETS; i++)
+        {
+            histogram.counts[i] = counts_[i].load(std::memory_order_relaxed);
+        }
+        histogram.total_count = total_count_.load(std::memory_order_relaxed);
+        histogram.min_s = min_s_.load(std::memory_order_relaxed);
+        histogram.max_s = max_s_.load(std::memory_order_relaxed);
+        histogram.sum_s = sum_s_.load(std::memory_order_relaxed);
+        return histogram;
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, DurationHistogram::NUM_BUCKETS> counts_;
+    std::atomic<uint64_t> total_count_;
+    std::atomic<double> min_s_;
+    std::atomic<double> max_s_;
+    std::atomic<double> sum_s_;
+};
+
+/**
+ * @brief Counts durations exceeding the warning threshold or the budget.
+ *
+ * See AtomicDurationHistogram regarding thread-safety.
+ */
+class ThresholdCounter
+{
+public:
+    ThresholdCounter(const double budget_s, const TimingThresholds &thresholds)
+        : budget_s_(budget_s),
+          warning_threshold_s_(thresholds.warning_fraction * budget_s),
+          near_misses_(0),
+          overruns_(0)
+    {
+    }
+
+    //! @brief Record a duration.  Must only be called by one thread.
+    void add(const double duration_s)
+    {
+        if (duration_s > budget_s_)
+        {
+            increment(overruns_);
+        }
+        else if (duration_s > warning_threshold_s_)
+        {
+            increment(near_misses_);
+        }
+    }
+
+    uint64_t get_near_misses() const
+    {
+        return near_misses_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t get_overruns() const
+    {
+        return overruns_.load(std::memory_order_relaxed);
+    }
+
+private:
+    const double budget_s_;
+    const double warning_threshold_s_;
+    std::atomic<uint64_t> near_misses_;
+    std::atomic<uint64_t> overruns_;
+};
+
+//! @brief Record an ActionTimingStatistics.  See AtomicDurationHistogram.
+class ActionTimingRecorder
+{
+public:
+    ActionTimingRecorder(const double max_action_duration_s,
+                         const double max_inter_action_duration_s,
+                         const TimingThresholds &thresholds)
+        : action_duration_thresholds_(max_action_duration_s, thresholds),
+          inter_action_duration_thresholds_(max_inter_action_duration_s,
+                                            thresholds)
+    {
+    }
+
+    void add_action_duration(const double duration_s)
+    {
+        action_duration_.add(duration_s);
+        action_duration_thresholds_.add(duration_s);
+    }
+
+    void add_inter_action_duration(const double duration_s)
+    {
+        inter_action_duration_.add(duration_s);
+        inter_action_duration_thresholds_.add(duration_s);
+    }
+
+    ActionTimingStatistics get() const
+    {
+        ActionTimingStatistics statistics;
+        statistics.action_duration = action_duration_.get();
+        statistics.inter_action_duration = inter_action_duration_.get();
+        statistics.action_duration_near_misses =
+            action_duration_thresholds_.get_near_misses();
+        statistics.inter_action_duration_near_misses =
+            inter_action_duration_thresholds_.get_near_misses();
+        statistics.action_duration_overruns =
+            action_duration_thresholds_.get_overruns();
+        statistics.inter_action_duration_overruns =
+            inter_action_duration_thresholds_.get_overruns();
+        return statistics;
+    }
+
+private:
+    AtomicDurationHistogram action_duration_;
+    AtomicDurationHistogram inter_action_duration_;
+    ThresholdCounter action_duration_thresholds_;
+    ThresholdCounter inter_action_duration_thresholds_;
+};
+}  // namespace internal
+
+}  // namespace robot_interfaces
@@ -8,6 +8,9 @@
 
 #include <memory>
 
+#include "observer_frontend.hpp"
+#include "remote_robot_bridge.hpp"
+#include "remote_robot_data.hpp"
 #include "robot_backend.hpp"
 #include "robot_data.hpp"
 #include "robot_frontend.hpp"
@@ -30,10 +33,20 @@ struct RobotInterfaceTypes
     typedef std::shared_ptr<SingleProcessData> SingleProcessDataPtr;
     typedef MultiProcessRobotData<Action, Observation> MultiProcessData;
     typedef std::shared_ptr<MultiProcessData> MultiProcessDataPtr;
+    typedef RemoteRobotData<Action, Observation> RemoteData;
+    typedef std::shared_ptr<RemoteData> RemoteDataPtr;
+
+    typedef RemoteRobotBridge<Action, Observation> RemoteBridge;
+    typedef std::shared_ptr<RemoteBridge> RemoteBridgePtr;
 
     typedef RobotFrontend<Action, Observation> Frontend;
     typedef std::shared_ptr<Frontend> FrontendPtr;
 
+    typedef ObserverFrontend<Observation> Observer;
+
+    typedef robot_interfaces::ActionClient<Action> ActionClient;
+    typedef std::shared_ptr<ActionClient> ActionClientPtr;
+
     typedef RobotLogger<Action, Observation> Logger;
 };
 
@@ -0,0 +1,167 @@
+/**
+ * @file
+ * @brief Strategies for waiting on new elements of a time series.
+ * @copyright 2020, Max Planck Gesellschaft. All rights reserved.
+ * @license BSD 3-clause
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+
+#include <time_series/time_series.hpp>
+
+namespace robot_interfaces
+{
+/**
+ * @brief Tell the CPU that we are in a busy-wait loop.
+ *
+ * Reduces power consumption and the penalty when leaving the loop.
+ */
+inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#else
+    std::this_thread::yield();
+#endif
+}
+
+/**
+ * @brief Describes how to wait for new elements of the RobotData time series.
+ *
+ * By default, waiting is done with the blocking wait of the time series.  This
+ * puts the thread to sleep until it is notified about the new element, which
+ * takes some time.  For very low latency between processes running on
+ * different cores, the thread can instead spin on the published time index for
+ * a bounded time before falling back to blocking.  Note that this keeps the
+ * CPU core busy while spinning.
+ *
+ * Use the static factory methods Blocking() and SpinThenBlock() to create
+ * instances.
+ */
+struct WaitStrategy
+{
+    enum class Mode
+    {
+        BLOCK = 0,
+        SPIN_THEN_BLOCK
+    };
+
+    Mode mode = Mode::BLOCK;
+
+    //! @brief Maximum time spent spinning before falling back to blocking.
+    double max_spin_duration_s = 0;
+
+    //! @brief Always use the blocking wait of the time series.
+    static WaitStrategy Blocking()
+    {
+        return WaitStrategy();
+    }
+
+    /**
+     * @brief Spin for at most max_spin_duration_s, then block.
+     *
+     * @param max_spin_duration_s  Maximum time spent spinning.  Should be
+     *     roughly the expected waiting time, e.g. one control period.
+     */
+    static WaitStrategy SpinThenBlock(double max_spin_duration_s = 0.001)
+    {
+        WaitStrategy strategy;
+        strategy.mode = Mode::SPIN_THEN_BLOCK;
+        strategy.max_spin_duration_s = max_spin_duration_s;
+        return strategy;
+    }
+};
+
+/**
+ * @brief Busy-wait until a condition is true.
+ *
+ * @param is_done  Function that returns true if the condition is met.
+ * @param max_duration_s  Maximum time to spin.
+ *
+ * @return Result of is_done() when returning.
+ */
+template <typename Predicate>
+bool spin_until(Predicate is_done, const double max_duration_s)
+{
+    typedef std::chrono::steady_clock Clock;
+    const Clock::time_point start = Clock::now();
+
+    // only check the clock every few iterations, it is comparably expensive
+    for (uint32_t i = 1; !is_done(); i++)
+    {
+        cpu_relax();
+        if (i % 64 == 0 &&
+            std::chrono::duration<double>(Clock::now() - start).count() >
+                max_duration_s)
+        {
+            return is_done();
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Wait until a time series contains the given time index.
+ *
+ * Depending on the strategy, spin on the published newest time index first,
+ * then fall back to the blocking wait of the time series.
+ *
+ * @param strategy  The wait strategy.
+ * @param published_timeindex  Newest time index as published by the writer of
+ *     the time series (see ControlBlock).  Only needs to be a lower bound of
+ *     the actual newest index.
+ * @param series  The time series.
+ * @param t  The time index to wait for.
+ * @param max_duration_s  Maximum time to wait.  Set to infinity to wait without
+ *     timeout.
+ *
+ * @return True if the time index is reached, false if timeout occurred.
+ */
+template <typename T>
+bool wait_for_timeindex(const WaitStrategy &strategy,
+                        const std::atomic<int64_t> &published_timeindex,
+                        const time_series::TimeSeriesInterface<T> &series,
+                        const time_series::Index t,
+                        double max_duration_s)
+{
+    if (strategy.mode == WaitStrategy::Mode::SPIN_THEN_BLOCK)
+    {
+        typedef std::chrono::steady_clock Clock;
+        const Clock::time_point start = Clock::now();
+        const double spin_duration_s =
+            std::min(strategy.max_spin_duration_s, max_duration_s);
+
+        if (spin_until([&]() { return published_timeindex.load() >= t; },
+                       spin_duration_s))
+        {
+            return true;
+        }
+
+        max_duration_s -=
+            std::chrono::duration<double>(Clock::now() - start).count();
+        if (max_duration_s <= 0)
+        {
+            return false;
+        }
+    }
+
+    if (std::isinf(max_duration_s))
+    {
+        // the time series waits without timeout if none is given
+        return series.wait_for_timeindex(t);
+    }
+    else
+    {
+        return series.wait_for_timeindex(t, max_duration_s);
+    }
+}
+
+}  // namespace robot_interfaces
@@ -0,0 +1,199 @@
+/**
+ * @file
+ * @brief Single thread that monitors deadlines of any number of clients.
+ * @copyright 2020, Max Planck Gesellschaft. All rights reserved.
+ * @license BSD 3-clause
+ */
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include <real_time_tools/thread.hpp>
+
+namespace robot_interfaces
+{
+/**
+ * @brief Watchdog thread that is shared by several clients.
+ *
+ * Clients (e.g. MonitoredRobotDriver) register a check function together with
+ * the time at which it should be called first.  The service keeps a heap of
+ * these times and calls each check function when it is due.  The check
+ * function returns whether it wants to be called again and, if so, when.
+ *
+ * This way any number of clients are monitored by a single real-time thread.
+ * Note that check functions are executed one after another in this thread, so
+ * they should be short.  They are called while holding the internal mutex of
+ * the service, so they must not call add() or remove().
+ *
+ * Use get_default() to get an instance that is shared by all clients of the
+ * process.
+ */
+class WatchdogService
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+    typedef uint64_t ClientId;
+
+    /**
+     * @brief Function that is called by the watchdog when it is due.
+     *
+     * Arguments are the current time and a reference to the time of the next
+     * call, which is to be set by the function.  Returns false if it should
+     * not be called again.
+     */
+    typedef std::function<bool(const Clock::time_point &now,
+                               Clock::time_point &next_check)>
+        CheckFunction;
+
+    //! @brief Starts the watchdog thread.
+    WatchdogService() : next_client_id_(0), is_stop_requested_(false)
+    {
+        thread_ = std::make_shared<real_time_tools::RealTimeThread>();
+        thread_->create_realtime_thread(&WatchdogService::loop, this);
+    }
+
+    //! @brief Stops the watchdog thread.  Remaining clients are not checked
+    //! anymore.
+    ~WatchdogService()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            is_stop_requested_ = true;
+        }
+        condition_.notify_all();
+        thread_->join();
+    }
+
+    /**
+     * @brief Get the watchdog service that is shared within the process.
+     *
+     * It is created on the first call and destroyed when the last user releases
+     * it.
+     */
+    static std::shared_ptr<WatchdogService> get_default()
+    {
+        static std::mutex default_mutex;
+        static std::weak_ptr<WatchdogService> default_instance;
+
+        std::lock_guard<std::mutex> lock(default_mutex);
+        std::shared_ptr<WatchdogService> instance = default_instance.lock();
+        if (!instance)
+        {
+            instance = std::make_shared<WatchdogService>();
+            default_instance = instance;
+        }
+        return instance;
+    }
+
+    /**
+     * @brief Register a client.
+     *
+     * @param check  Check function of the client, see CheckFunction.
+     * @param first_check  Time at which the check function is called first.
+     *
+     * @return ID of the client, to be used for remove().
+     */
+    ClientId add(CheckFunction check, const Clock::time_point &first_check)
+    {
+        ClientId id;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            id = next_client_id_++;
+            clients_[id] = check;
+            schedule_.push(std::make_pair(first_check, id));
+        }
+        // the new client may be due before the one the thread is waiting for
+        condition_.notify_all();
+
+        return id;
+    }
+
+    /**
+     * @brief Unregister a client.
+     *
+     * When this returns, the check function of the client is not running and
+     * will not be called anymore.
+     */
+    void remove(const ClientId id)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // the entry in the schedule is skipped when it is due
+        clients_.erase(id);
+    }
+
+private:
+    typedef std::pair<Clock::time_point, ClientId> ScheduleEntry;
+
+    //! @brief Min-heap of the next check time of all clients.
+    std::priority_queue<ScheduleEntry,
+                        std::vector<ScheduleEntry>,
+                        std::greater<ScheduleEntry>>
+        schedule_;
+    std::map<ClientId, CheckFunction> clients_;
+    ClientId next_client_id_;
+
+    bool is_stop_requested_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+
+    std::shared_ptr<real_time_tools::RealTimeThread> thread_;
+
+    static void *loop(void *instance_pointer)
+    {
+        ((WatchdogService *)(instance_pointer))->loop();
+        return nullptr;
+    }
+
+    void loop()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        while (!is_stop_requested_)
+        {
+            if (schedule_.empty())
+            {
+                condition_.wait(lock);
+                continue;
+            }
+
+            const Clock::time_point next_check = schedule_.top().first;
+            if (Clock::now() < next_check)
+            {
+                // wakes up early if a client is added or stop is requested
+                condition_.wait_until(lock, next_check);
+                continue;
+            }
+
+            const ClientId id = schedule_.top().second;
+            schedule_.pop();
+
+            auto client = clients_.find(id);
+            if (client == clients_.end())
+            {
+                // client was removed
+                continue;
+            }
+
+            Clock::time_point next_client_check;
+            if (client->second(Clock::now(), next_client_check))
+            {
+                schedule_.push(std::make_pair(next_client_check, id));
+            }
+            else
+            {
+                clients_.erase(client);
+            }
+        }
+    }
+};
+
+}  // namespace robot_interfaces
@@ -19,21 +19,197 @@
  * \file
  * \brief Create bindings for generic types
  */
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+
 #include <robot_interfaces/pybind_helper.hpp>
+#include <robot_interfaces/robot_log_file.hpp>
+#include <robot_interfaces/robot_log_reader.hpp>
+#include <robot_interfaces/socket_transport.hpp>
 #include <robot_interfaces/status.hpp>
+#include <robot_interfaces/timing_statistics.hpp>
+#include <robot_interfaces/wait_strategy.hpp>
 
 using namespace robot_interfaces;
 
+/**
+ * @brief Create a read-only NumPy array that refers to the values of a view.
+ *
+ * @param view  The view.
+ * @param reader  Python object of the reader, which is kept alive as long as
+ *     the array exists.
+ */
+pybind11::array_t<double> column_view_to_array(const RobotLogColumnView &view,
+                                               pybind11::handle reader)
+{
+    pybind11::array_t<double> array({view.size},
+                                    {view.stride * sizeof(double)},
+                                    view.data,
+                                    reader);
+    // the file is mapped read-only
+    array.attr("setflags")(pybind11::arg("write") = false);
+    return array;
+}
+
+/**
+ * @brief Get a column of a log as NumPy array.
+ *
+ * Without copying if possible, i.e. if the log has the RECORDS layout or only
+ * one chunk.
+ */
+pybind11::array_t<double> get_log_column(pybind11::object reader_object,
+                                         const size_t column)
+{
+    const RobotLogReader &reader = reader_object.cast<const RobotLogReader &>();
+    const std::vector<RobotLogColumnView> views =
+        reader.get_column_views(column);
+
+    if (views.size() == 1)
+    {
+        return column_view_to_array(views[0], reader_object);
+    }
+
+    pybind11::array_t<double> array(reader.get_number_of_records());
+    double *data = array.mutable_data();
+    for (const RobotLogColumnView &view : views)
+    {
+        std::copy(view.data, view.data + view.size, data);
+        data += view.size;
+    }
+    return array;
+}
+
 PYBIND11_MODULE(py_generic, m)
 {
+    pybind11::class_<StepTiming>(m, "StepTiming")
+        .def(pybind11::init<>())
+        .def_readwrite("overrun", &StepTiming::overrun)
+        .def_readwrite("overrun_count", &StepTiming::overrun_count)
+        .def_readwrite("step_duration_s", &StepTiming::step_duration_s)
+        .def_readwrite("max_step_duration_s", &StepTiming::max_step_duration_s)
+        .def_readwrite("get_observation_duration_s",
+                       &StepTiming::get_observation_duration_s)
+        .def_readwrite("apply_action_duration_s",
+                       &StepTiming::apply_action_duration_s);
+
     pybind11::class_<Status> pystatus(m, "Status");
     pystatus.def(pybind11::init<>())
         .def_readwrite("action_repetitions", &Status::action_repetitions)
         .def_readwrite("error_status", &Status::error_status)
-        .def_readwrite("error_message", &Status::error_message);
+        .def_readwrite("error_message", &Status::error_message)
+        .def_readwrite("timing", &Status::timing);
 
     pybind11::enum_<Status::ErrorStatus>(pystatus, "ErrorStatus")
         .value("NO_ERROR", Status::ErrorStatus::NO_ERROR)
         .value("DRIVER_ERROR", Status::ErrorStatus::DRIVER_ERROR)
         .value("BACKEND_ERROR", Status::ErrorStatus::BACKEND_ERROR);
+
+    pybind11::class_<WaitStrategy> pywait(m, "WaitStrategy");
+    pywait.def(pybind11::init<>())
+        .def_readwrite("mode", &WaitStrategy::mode)
+        .def_readwrite("max_spin_duration_s",
+                       &WaitStrategy::max_spin_duration_s)
+        .def_static("Blocking", &WaitStrategy::Blocking)
+        .def_static("SpinThenBlock",
+                    &WaitStrategy::SpinThenBlock,
+                    pybind11::arg("max_spin_duration_s") = 0.001);
+
+    pybind11::enum_<WaitStrategy::Mode>(pywait, "Mode")
+        .value("BLOCK", WaitStrategy::Mode::BLOCK)
+        .value("SPIN_THEN_BLOCK", WaitStrategy::Mode::SPIN_THEN_BLOCK);
+
+    pybind11::class_<DurationHistogram>(m, "DurationHistogram")
+        .def(pybind11::init<>())
+        .def_readonly("counts", &DurationHistogram::counts)
+        .def_readonly("total_count", &DurationHistogram::total_count)
+        .def_readonly("min_s", &DurationHistogram::min_s)
+        .def_readonly("max_s", &DurationHistogram::max_s)
+        .def_readonly("sum_s", &DurationHistogram::sum_s)
+        .def("mean_s", &DurationHistogram::mean_s)
+        .def_static("get_bucket", &DurationHistogram::get_bucket)
+        .def_static("get_bucket_upper_bound_s",
+                    &DurationHistogram::get_bucket_upper_bound_s);
+
+    pybind11::class_<TimingThresholds>(m, "TimingThresholds")
+        .def(pybind11::init<>())
+        .def_readwrite("warning_fraction", &TimingThresholds::warning_fraction)
+        .def_readwrite("hard_fraction", &TimingThresholds::hard_fraction);
+
+    pybind11::class_<ActionTimingStatistics>(m, "ActionTimingStatistics")
+        .def(pybind11::init<>())
+        .def_readonly("action_duration",
+                      &ActionTimingStatistics::action_duration)
+        .def_readonly("inter_action_duration",
+                      &ActionTimingStatistics::inter_action_duration)
+        .def_readonly("action_duration_near_misses",
+                      &ActionTimingStatistics::action_duration_near_misses)
+        .def_readonly(
+            "inter_action_duration_near_misses",
+            &ActionTimingStatistics::inter_action_duration_near_misses)
+        .def_readonly("action_duration_overruns",
+                      &ActionTimingStatistics::action_duration_overruns)
+        .def_readonly("inter_action_duration_overruns",
+                      &ActionTimingStatistics::inter_action_duration_overruns);
+
+    pybind11::enum_<RobotLogFormat>(m, "RobotLogFormat")
+        .value("TEXT", RobotLogFormat::TEXT)
+        .value("BINARY", RobotLogFormat::BINARY)
+        .value("BINARY_COLUMN_CHUNKS", RobotLogFormat::BINARY_COLUMN_CHUNKS);
+
+    pybind11::class_<TransportStatistics>(m, "TransportStatistics")
+        .def(pybind11::init<>())
+        .def_readonly("messages_sent", &TransportStatistics::messages_sent)
+        .def_readonly("messages_received",
+                      &TransportStatistics::messages_received)
+        .def_readonly("messages_lost", &TransportStatistics::messages_lost)
+        .def_readonly("messages_unacknowledged",
+                      &TransportStatistics::messages_unacknowledged)
+        .def_readonly("elements_sent", &TransportStatistics::elements_sent)
+        .def_readonly("elements_received",
+                      &TransportStatistics::elements_received)
+        .def_readonly("last_latency_s", &TransportStatistics::last_latency_s)
+        .def_readonly("mean_latency_s", &TransportStatistics::mean_latency_s)
+        .def_readonly("max_latency_s", &TransportStatistics::max_latency_s);
+
+    pybind11::enum_<RobotLogLayout>(m, "RobotLogLayout")
+        .value("RECORDS", RobotLogLayout::RECORDS)
+        .value("COLUMN_CHUNKS", RobotLogLayout::COLUMN_CHUNKS);
+
+    pybind11::class_<RobotLogReader>(m, "RobotLogReader")
+        .def(pybind11::init<const std::string &>(), pybind11::arg("filename"))
+        .def("get_layout", &RobotLogReader::get_layout)
+        .def("get_column_names", &RobotLogReader::get_column_names)
+        .def("get_number_of_columns", &RobotLogReader::get_number_of_columns)
+        .def("get_number_of_records", &RobotLogReader::get_number_of_records)
+        .def("get_column_index", &RobotLogReader::get_column_index)
+        .def("get_value",
+             &RobotLogReader::get_value,
+             pybind11::arg("record"),
+             pybind11::arg("column"))
+        .def("get_record", &RobotLogReader::get_record)
+        .def("find_record", &RobotLogReader::find_record)
+        .def("find_record_by_timestamp",
+             &RobotLogReader::find_record_by_timestamp)
+        .def("get_column", &get_log_column, pybind11::arg("column"))
+        .def(
+            "get_column",
+            [](pybind11::object self, const std::string &name) {
+                return get_log_column(
+                    self,
+                    self.cast<const RobotLogReader &>().get_column_index(name));
+            },
+            pybind11::arg("name"))
+        .def(
+            "get_column_chunks",
+            [](pybind11::object self, const size_t column) {
+                pybind11::list chunks;
+                for (const RobotLogColumnView &view :
+                     self.cast<const RobotLogReader &>().get_column_views(
+                         column))
+                {
+                    chunks.append(column_view_to_array(view, self));
+                }
+                return chunks;
+            },
+            pybind11::arg("column"));
 }
@@ -0,0 +1,194 @@
+/**
+ * @file
+ * @brief Tests for MonitoredRobotDriver
+ * @copyright Copyright (c) 2020, Max Planck Gesellschaft.
+ */
+#include <gtest/gtest.h>
+#include <atomic>
+#include <robot_interfaces/example.hpp>
+#include <robot_interfaces/monitored_robot_driver.hpp>
+
+using namespace robot_interfaces;
+
+typedef MonitoredRobotDriver<example::Driver> MonitoredDriver;
+
+// Test that no error is reported as long as the timing constraints are met
+TEST(TestMonitoredRobotDriver, actions_on_time)
+{
+    auto driver = std::make_shared<example::Driver>(0, 1000);
+    MonitoredDriver monitored_driver(driver, 0.5, 0.5);
+
+    example::Action action;
+    for (int i = 0; i < 10; i++)
+    {
+        monitored_driver.apply_action(action);
+    }
+
+    ASSERT_EQ("", monitored_driver.get_error());
+}
+
+// Test that durations of actions and gaps between them are recorded
+TEST(TestMonitoredRobotDriver, timing_statistics)
+{
+    // the example driver needs about 2 ms per action
+    auto driver = std::make_shared<example::Driver>(0, 1000);
+    MonitoredDriver monitored_driver(driver, 0.5, 0.1);
+
+    example::Action action;
+    for (int i = 0; i < 5; i++)
+    {
+        monitored_driver.apply_action(action);
+        real_time_tools::Timer::sleep_sec(0.001);
+    }
+    // near miss of the inter-action duration
+    real_time_tools::Timer::sleep_sec(0.091);
+    monitored_driver.apply_action(action);
+
+    ActionTimingStatistics statistics =
+        monitored_driver.get_timing_statistics();
+
+    ASSERT_EQ(6u, statistics.action_duration.total_count);
+    ASSERT_EQ(5u, statistics.inter_action_duration.total_count);
+    ASSERT_GE(statistics.action_duration.min_s, 0.002);
+    ASSERT_GE(statistics.inter_action_duration.max_s, 0.092);
+    ASSERT_EQ(0u, statistics.action_duration_near_misses);
+    ASSERT_EQ(1u, statistics.inter_action_duration_near_misses);
+
+    uint64_t histogram_total = 0;
+    for (uint64_t count : statistics.action_duration.counts)
+    {
+        histogram_total += count;
+    }
+    ASSERT_EQ(6u, histogram_total);
+    // 2 ms are in the bucket [1024, 2048) or [2048, 4096) µs
+    ASSERT_EQ(6u,
+              statistics.action_duration.counts[11] +
+                  statistics.action_duration.counts[12]);
+
+    ASSERT_EQ("", monitored_driver.get_error());
+}
+
+// Test that exceeding the budget is only counted below the hard threshold
+TEST(TestMonitoredRobotDriver, hard_threshold)
+{
+    TimingThresholds thresholds;
+    thresholds.hard_fraction = 3.0;
+
+    auto driver = std::make_shared<example::Driver>(0, 1000);
+    MonitoredDriver monitored_driver(driver, 0.5, 0.05, nullptr, thresholds);
+
+    example::Action action;
+    monitored_driver.apply_action(action);
+    real_time_tools::Timer::sleep_sec(0.08);
+    monitored_driver.apply_action(action);
+
+    ActionTimingStatistics statistics =
+        monitored_driver.get_timing_statistics();
+    ASSERT_EQ(1u, statistics.inter_action_duration_overruns);
+    ASSERT_EQ(0u, statistics.inter_action_duration_near_misses);
+    ASSERT_EQ("", monitored_driver.get_error());
+
+    // exceed the hard threshold
+    real_time_tools::Timer::sleep_sec(0.25);
+    ASSERT_EQ("Action did not start on time, shutting down.",
+              monitored_driver.get_error());
+}
+
+// Test that the robot is shut down if the next action does not start on time
+TEST(TestMonitoredRobotDriver, action_does_not_start_on_time)
+{
+    auto driver = std::make_shared<example::Driver>(0, 1000);
+    MonitoredDriver monitored_driver(driver, 0.5, 0.05);
+
+    example::Action action;
+    monitored_driver.apply_action(action);
+    ASSERT_EQ("", monitored_driver.get_error());
+
+    real_time_tools::Timer::sleep_sec(0.2);
+
+    ASSERT_EQ("Action did not start on time, shutting down.",
+              monitored_driver.get_error());
+}
+
+// Test that the robot is shut down if an action takes too long
+TEST(TestMonitoredRobotDriver, action_does_not_end_on_time)
+{
+    // the example driver needs about 2 ms per action
+    auto driver = std::make_shared<example::Driver>(0, 1000);
+    MonitoredDriver monitored_driver(driver, 0.0001, 0.5);
+
+    example::Action action;
+    monitored_driver.apply_action(action);
+    real_time_tools::Timer::sleep_sec(0.05);
+
+    ASSERT_EQ("Action did not end on time, shutting down.",
+              monitored_driver.get_error());
+}
+
+// Test that drivers sharing a watchdog are monitored independently
+TEST(TestMonitoredRobotDriver, shared_watchdog)
+{
+    auto watchdog = std::make_shared<WatchdogService>();
+
+    auto driver_a = std::make_shared<example::Driver>(0, 1000);
+    auto driver_b = std::make_shared<example::Driver>(0, 1000);
+    MonitoredDriver monitored_driver_a(driver_a, 0.5, 0.05, watchdog);
+    MonitoredDriver monitored_driver_b(driver_b, 0.5, 0.05, watchdog);
+
+    example::Action action;
+    monitored_driver_a.apply_action(action);
+    monitored_driver_b.apply_action(action);
+
+    // only keep driver b busy
+    for (int i = 0; i < 20; i++)
+    {
+        real_time_tools::Timer::sleep_sec(0.01);
+        monitored_driver_b.apply_action(action);
+    }
+
+    ASSERT_EQ("Action did not start on time, shutting down.",
+              monitored_driver_a.get_error());
+    ASSERT_EQ("", monitored_driver_b.get_error());
+}
+
+//! @brief Driver that takes long to shut down.
+class SlowShutdownDriver : public example::Driver
+{
+public:
+    std::atomic<bool> is_shutdown_finished;
+
+    SlowShutdownDriver() : example::Driver(0, 1000), is_shutdown_finished(false)
+    {
+    }
+
+    void shutdown() override
+    {
+        real_time_tools::Timer::sleep_sec(1.0);
+        is_shutdown_finished = true;
+    }
+};
+
+// Test that a slow shutdown does not delay the monitoring of other drivers
+TEST(TestMonitoredRobotDriver, slow_shutdown)
+{
+    auto watchdog = std::make_shared<WatchdogService>();
+
+    auto slow_driver = std::make_shared<SlowShutdownDriver>();
+    auto driver = std::make_shared<example::Driver>(0, 1000);
+    MonitoredRobotDriver<SlowShutdownDriver> monitored_slow_driver(
+        slow_driver, 0.5, 0.05, watchdog);
+    MonitoredDriver monitored_driver(driver, 0.5, 0.1, watchdog);
+
+    example::Action action;
+    monitored_slow_driver.apply_action(action);
+    monitored_driver.apply_action(action);
+
+    // the slow driver is shut down first, the other one while the shutdown
+    // of the slow one is still running
+    real_time_tools::Timer::sleep_sec(0.3);
+    ASSERT_EQ("Action did not start on time, shutting down.",
+              monitored_slow_driver.get_error());
+    ASSERT_EQ("Action did not start on time, shutting down.",
+              monitored_driver.get_error());
+    ASSERT_FALSE(slow_driver->is_shutdown_finished);
+}
@@ -4,7 +4,23 @@
  * @copyright Copyright (c) 2019, Max Planck Gesellschaft.
  */
 #include <gtest/gtest.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
 #include <robot_interfaces/example.hpp>
+#include <robot_interfaces/observation_dispatcher.hpp>
+#include <robot_interfaces/observer_frontend.hpp>
+#include <robot_interfaces/remote_robot_bridge.hpp>
+#include <robot_interfaces/remote_robot_data.hpp>
 #include <robot_interfaces/robot_backend.hpp>
 #include <robot_interfaces/robot_frontend.hpp>
 
@@ -33,6 +49,65 @@ protected:
     }
 };
 
+/**
+ * @brief Driver that reports an error once an action is applied the fourth
+ * time.
+ */
+class FailingDriver : public example::Driver
+{
+public:
+    FailingDriver() : example::Driver(0, 1000), num_applied_actions_(0)
+    {
+    }
+
+    Action apply_action(const Action &action) override
+    {
+        num_applied_actions_++;
+        return example::Driver::apply_action(action);
+    }
+
+    std::string get_error() override
+    {
+        return num_applied_actions_ >= 4 ? "Failed to apply action." : "";
+    }
+
+private:
+    int num_applied_actions_;
+};
+
+/**
+ * @brief Driver that counts the observations requested before initialize()
+ * was called.
+ */
+class InitializationCheckingDriver : public example::Driver
+{
+public:
+    std::atomic<bool> is_initialized;
+    std::atomic<int> num_early_observations;
+
+    InitializationCheckingDriver()
+        : example::Driver(0, 1000),
+          is_initialized(false),
+          num_early_observations(0)
+    {
+    }
+
+    void initialize() override
+    {
+        example::Driver::initialize();
+        is_initialized = true;
+    }
+
+    Observation get_latest_observation() override
+    {
+        if (!is_initialized)
+        {
+            num_early_observations++;
+        }
+        return example::Driver::get_latest_observation();
+    }
+};
+
 // Test if the "max_number_of_actions" feature is working as expected
 TEST_F(TestRobotBackend, max_number_of_actions)
 {
@@ -66,4 +141,925 @@ TEST_F(TestRobotBackend, max_number_of_actions)
     ASSERT_TRUE(status.has_error());
     ASSERT_EQ(Status::ErrorStatus::BACKEND_ERROR, status.error_status);
     ASSERT_EQ("Maximum number of actions reached.", status.error_message);
+
+    // the error is flagged and further actions are rejected
+    backend.wait_until_terminated();
+    ASSERT_TRUE(frontend.has_backend_error());
+    ASSERT_THROW(frontend.append_desired_action(action), std::runtime_error);
+}
+
+// Test if recording multiple observations per action is working as expected
+TEST_F(TestRobotBackend, observations_per_action)
+{
+    constexpr bool real_time_mode = false;
+    constexpr uint32_t observations_per_action = 3;
+    constexpr int num_actions = 5;
+
+    auto multi_rate_data =
+        std::make_shared<Data>(1000, observations_per_action);
+
+    Backend backend(driver, multi_rate_data, real_time_mode);
+    backend.initialize();
+    Frontend frontend(multi_rate_data);
+
+    ASSERT_EQ(observations_per_action, frontend.get_observations_per_action());
+
+    Action action;
+    robot_interfaces::TimeIndex t = 0;
+    for (int i = 0; i < num_actions; i++)
+    {
+        action.values[0] = 100 * i;
+        action.values[1] = 100 * i + 1;
+        t = frontend.append_desired_action(action);
+        ASSERT_EQ(i, t);
+    }
+
+    // wait until the last action has been applied completely
+    frontend.wait_until_timeindex(frontend.get_observation_timeindex(t + 1));
+
+    for (int i = 0; i < num_actions; i++)
+    {
+        robot_interfaces::TimeIndex obs_t =
+            frontend.get_observation_timeindex(i);
+        ASSERT_EQ(i * observations_per_action, obs_t);
+
+        // all observations recorded while the action is held map back to it
+        // and reflect the held action
+        for (uint32_t j = 1; j < observations_per_action; j++)
+        {
+            ASSERT_EQ(i, frontend.get_action_timeindex(obs_t + j));
+            Observation observation = frontend.get_observation(obs_t + j);
+            ASSERT_EQ(100 * i, observation.values[0]);
+            ASSERT_EQ(100 * i + 1, observation.values[1]);
+        }
+
+        ASSERT_EQ(100 * i, frontend.get_applied_action(i).values[0]);
+    }
+}
+
+// Test if a driver error while holding the action ends the step with an error
+TEST_F(TestRobotBackend, observations_per_action_driver_error)
+{
+    constexpr bool real_time_mode = false;
+    constexpr uint32_t observations_per_action = 2;
+
+    auto failing_driver = std::make_shared<FailingDriver>();
+    auto multi_rate_data =
+        std::make_shared<Data>(1000, observations_per_action);
+
+    Backend backend(failing_driver, multi_rate_data, real_time_mode);
+    backend.initialize();
+    Frontend frontend(multi_rate_data);
+
+    // the second action fails when it is applied again in its held sub-step
+    Action action;
+    frontend.append_desired_action(action);
+    frontend.append_desired_action(action);
+
+    Status status = frontend.get_status(2);
+    ASSERT_EQ(Status::ErrorStatus::DRIVER_ERROR, status.error_status);
+    ASSERT_EQ("Failed to apply action.", status.error_message);
+
+    backend.wait_until_terminated();
+    ASSERT_TRUE(frontend.has_backend_error());
+    ASSERT_EQ(1, multi_rate_data->applied_action->newest_timeindex());
+    ASSERT_EQ(3, multi_rate_data->observation->newest_timeindex());
+}
+
+// Test if a restarted backend resumes on the data of the previous one
+TEST_F(TestRobotBackend, reattach_to_previous_data)
+{
+    typedef robot_interfaces::MultiProcessRobotData<Action, Observation>
+        MultiProcessData;
+
+    const std::string shared_memory_id = "test_robot_backend_reattach";
+    constexpr bool real_time_mode = false;
+    constexpr bool reattach = true;
+
+    MultiProcessData::clear_memory(shared_memory_id);
+
+    // The data of the first backend is kept alive to simulate a crashed
+    // backend process which does not clean up the shared memory.
+    auto first_data = std::make_shared<MultiProcessData>(
+        shared_memory_id, true, 1000, 1, reattach);
+    auto frontend_data =
+        std::make_shared<MultiProcessData>(shared_memory_id, false);
+    Frontend frontend(frontend_data);
+
+    Action action;
+    action.values[0] = 42;
+    action.values[1] = 42;
+
+    {
+        Backend backend(driver, first_data, real_time_mode);
+        backend.initialize();
+
+        for (int i = 0; i < 3; i++)
+        {
+            frontend.append_desired_action(action);
+        }
+        // wait until the backend is waiting for the next action
+        frontend.wait_until_timeindex(3);
+    }
+    ASSERT_EQ(1u, frontend.get_backend_generation());
+
+    auto second_data = std::make_shared<MultiProcessData>(
+        shared_memory_id, true, 1000, 1, reattach);
+    Backend backend(driver, second_data, real_time_mode);
+    ASSERT_EQ(2u, frontend.get_backend_generation());
+
+    // the frontend can continue to use its data and the new backend continues
+    // after the index of the previous one
+    action.values[0] = 123;
+    robot_interfaces::TimeIndex t = frontend.append_desired_action(action);
+    ASSERT_EQ(3, t);
+
+    frontend.wait_until_timeindex(t + 1);
+    ASSERT_EQ(123, frontend.get_applied_action(t).values[0]);
+    ASSERT_EQ(123, frontend.get_observation(t + 1).values[0]);
+    ASSERT_EQ(t + 1, frontend.get_current_timeindex());
+
+    MultiProcessData::clear_memory(shared_memory_id);
+}
+
+// Test if missing observations of a held action are filled in only once the
+// driver is initialized
+TEST_F(TestRobotBackend, reattach_fill_in_after_initialize)
+{
+    constexpr bool real_time_mode = false;
+    constexpr uint32_t observations_per_action = 2;
+
+    // data of a previous backend that was interrupted while holding action 0
+    auto multi_rate_data =
+        std::make_shared<Data>(1000, observations_per_action);
+    Action action;
+    multi_rate_data->desired_action->append(action);
+    multi_rate_data->applied_action->append(action);
+    multi_rate_data->observation->append(Observation());
+    multi_rate_data->status->append(Status());
+
+    auto checking_driver = std::make_shared<InitializationCheckingDriver>();
+    Backend backend(checking_driver, multi_rate_data, real_time_mode);
+    Frontend frontend(multi_rate_data);
+
+    // give the backend thread a chance to use the driver too early
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    backend.initialize();
+
+    TimeIndex t = frontend.append_desired_action(action);
+    ASSERT_EQ(1, t);
+    frontend.wait_until_timeindex(frontend.get_observation_timeindex(t + 1));
+
+    ASSERT_EQ(0, checking_driver->num_early_observations);
+    // observation 1 was filled in, so the indices are still aligned
+    ASSERT_EQ(5u, multi_rate_data->observation->length());
+    ASSERT_EQ(4, multi_rate_data->observation->newest_timeindex());
+}
+
+// Test if actions are passed correctly when spinning instead of blocking
+TEST_F(TestRobotBackend, spin_wait_strategy)
+{
+    constexpr bool real_time_mode = false;
+
+    data->wait_strategy = robot_interfaces::WaitStrategy::SpinThenBlock(0.01);
+
+    Backend backend(driver, data, real_time_mode);
+    backend.initialize();
+    Frontend frontend(data);
+
+    Action action;
+    for (int i = 0; i < 20; i++)
+    {
+        action.values[0] = i;
+        action.values[1] = 2 * i;
+        robot_interfaces::TimeIndex t = frontend.append_desired_action(action);
+        frontend.wait_until_timeindex(t + 1);
+
+        Observation observation = frontend.get_observation(t + 1);
+        ASSERT_EQ(i, observation.values[0]);
+        ASSERT_EQ(2 * i, observation.values[1]);
+    }
+}
+
+// Test if a backend that is waiting for an action terminates right away
+TEST_F(TestRobotBackend, shutdown_while_waiting_for_action)
+{
+    constexpr bool real_time_mode = false;
+
+    Backend backend(driver, data, real_time_mode);
+    backend.initialize();
+    Frontend frontend(data);
+
+    Action action;
+    robot_interfaces::TimeIndex t = frontend.append_desired_action(action);
+    frontend.wait_until_timeindex(t + 1);
+
+    // let the backend fall asleep waiting for the next action
+    real_time_tools::Timer::sleep_sec(0.05);
+
+    const double start = real_time_tools::Timer::get_current_time_sec();
+    backend.request_shutdown();
+    backend.wait_until_terminated();
+    const double duration =
+        real_time_tools::Timer::get_current_time_sec() - start;
+
+    // without notification this takes up to the 100 ms polling interval
+    ASSERT_LT(duration, 0.05);
+}
+
+// Test if the frontend step() returns the observation after the action
+TEST_F(TestRobotBackend, frontend_step)
+{
+    constexpr bool real_time_mode = false;
+    constexpr uint32_t observations_per_action = 2;
+
+    auto multi_rate_data =
+        std::make_shared<Data>(1000, observations_per_action);
+
+    Backend backend(driver, multi_rate_data, real_time_mode);
+    backend.initialize();
+    Frontend frontend(multi_rate_data);
+
+    Action action;
+    for (int i = 0; i < 10; i++)
+    {
+        action.values[0] = 10 * i;
+        action.values[1] = 10 * i + 1;
+        Frontend::StepResult result = frontend.step(action);
+
+        ASSERT_EQ(i, result.timeindex);
+        ASSERT_EQ(10 * i, result.observation.values[0]);
+        ASSERT_EQ(10 * i + 1, result.observation.values[1]);
+        ASSERT_FALSE(result.status.has_error());
+    }
+}
+
+// Test if step() returns the error instead of blocking if the backend stops
+TEST_F(TestRobotBackend, frontend_step_backend_error)
+{
+    constexpr bool real_time_mode = false;
+    constexpr uint32_t observations_per_action = 2;
+
+    auto failing_driver = std::make_shared<FailingDriver>();
+    auto multi_rate_data =
+        std::make_shared<Data>(1000, observations_per_action);
+
+    Backend backend(failing_driver, multi_rate_data, real_time_mode);
+    backend.initialize();
+    Frontend frontend(multi_rate_data);
+
+    Action action;
+    Frontend::StepResult result = frontend.step(action);
+    ASSERT_FALSE(result.status.has_error());
+
+    // the backend stops before the observation of the step is recorded
+    result = frontend.step(action);
+    ASSERT_EQ(1, result.timeindex);
+    ASSERT_EQ(Status::ErrorStatus::DRIVER_ERROR, result.status.error_status);
+}
+
+// Test if step() throws instead of blocking if the backend is shut down
+TEST_F(TestRobotBackend, frontend_step_backend_terminated)
+{
+    constexpr bool real_time_mode = false;
+
+    Backend backend(driver, data, real_time_mode);
+    backend.initialize();
+    Frontend frontend(data);
+    ASSERT_FALSE(frontend.is_backend_terminated());
+
+    backend.request_shutdown();
+    backend.wait_until_terminated();
+    ASSERT_TRUE(frontend.is_backend_terminated());
+    ASSERT_FALSE(frontend.has_backend_error());
+
+    Action action;
+    ASSERT_THROW(frontend.step(action), std::runtime_error);
+}
+
+// Test waiting for observations with timeout
+TEST_F(TestRobotBackend, frontend_wait_with_timeout)
+{
+    constexpr bool real_time_mode = false;
+
+    Backend backend(driver, data, real_time_mode);
+    backend.initialize();
+    Frontend frontend(data);
+
+    // the backend does not start before the first action is provided
+    ASSERT_FALSE(frontend.try_wait_until_timeindex(0));
+    ASSERT_FALSE(frontend.wait_until_timeindex(0, 0.01));
+    ASSERT_EQ(time_series::EMPTY,
+              frontend.wait_for_any_newer_than(time_series::EMPTY, 0.01));
+
+    Action action;
+    robot_interfaces::TimeIndex t = frontend.append_desired_action(action);
+    ASSERT_TRUE(frontend.wait_until_timeindex(t + 1, 10.0));
+    ASSERT_TRUE(frontend.try_wait_until_timeindex(t + 1));
+
+    // no further action, so no new observation
+    ASSERT_FALSE(frontend.wait_until_timeindex(t + 2, 0.01));
+    ASSERT_EQ(t + 1, frontend.wait_for_any_newer_than(t + 1, 0.01));
+
+    frontend.append_desired_action(action);
+    ASSERT_EQ(t + 2, frontend.wait_for_any_newer_than(t + 1));
+}
+
+// Test the prediction of the deadline for the next action
+TEST_F(TestRobotBackend, action_deadline)
+{
+    constexpr bool real_time_mode = true;
+    constexpr uint32_t max_action_repetitions = 1000;
+
+    Backend backend(driver, data, real_time_mode);
+    backend.set_max_action_repetitions(max_action_repetitions);
+    backend.initialize();
+    Frontend frontend(data);
+
+    // backend waits for the first action
+    Frontend::ActionDeadline deadline = frontend.get_action_deadline();
+    ASSERT_EQ(0, deadline.timeindex);
+    ASSERT_TRUE(std::isinf(deadline.time_until_needed_s));
+
+    // let the backend repeat the action for some steps
+    Action action;
+    frontend.append_desired_action(action);
+    frontend.wait_until_timeindex(10);
+
+    deadline = frontend.get_action_deadline();
+    // example driver takes about 2 ms per step
+    ASSERT_GT(deadline.step_period_s, 0.001);
+    ASSERT_LT(deadline.step_period_s, 0.1);
+    ASSERT_GE(deadline.timeindex, 10);
+    ASSERT_LT(deadline.time_until_needed_s, 2 * deadline.step_period_s);
+    ASSERT_GT(deadline.time_until_error_s, deadline.time_until_needed_s);
+    ASSERT_LT(deadline.time_until_error_s,
+              max_action_repetitions * deadline.step_period_s);
+
+    // queueing actions moves the deadline to the future and resets the
+    // repetitions
+    for (int i = 0; i < 100; i++)
+    {
+        frontend.append_desired_action(action);
+    }
+    Frontend::ActionDeadline queued_deadline = frontend.get_action_deadline();
+    ASSERT_GT(queued_deadline.timeindex, deadline.timeindex + 90);
+    ASSERT_GT(queued_deadline.time_until_needed_s,
+              deadline.time_until_needed_s + 50 * deadline.step_period_s);
+    ASSERT_GT(queued_deadline.time_until_error_s,
+              queued_deadline.time_until_needed_s +
+                  (max_action_repetitions - 1) * deadline.step_period_s);
+}
+
+// Test arbitration of the actions of several clients
+TEST_F(TestRobotBackend, action_clients)
+{
+    constexpr bool real_time_mode = false;
+    constexpr double first_action_timeout =
+        std::numeric_limits<double>::infinity();
+    constexpr uint32_t max_number_of_actions = 0;
+    constexpr bool run_in_thread = false;
+
+    Backend backend(driver,
+                    data,
+                    real_time_mode,
+                    first_action_timeout,
+                    max_number_of_actions,
+                    run_in_thread);
+    backend.initialize();
+    Frontend frontend(data);
+
+    auto low = frontend.create_action_client(1);
+    auto high = frontend.create_action_client(2);
+
+    Action action;
+    action.values[1] = 0;
+
+    // without submissions, there is no action
+    ASSERT_FALSE(backend.step());
+
+    action.values[0] = 10;
+    low->submit(action);
+    ASSERT_TRUE(backend.step());
+    ASSERT_EQ(10, frontend.get_desired_action(0).values[0]);
+
+    // the client with higher priority wins
+    action.values[0] = 20;
+    high->submit(action);
+    action.values[0] = 11;
+    low->submit(action);
+    ASSERT_TRUE(backend.step());
+    ASSERT_EQ(20, frontend.get_desired_action(1).values[0]);
+
+    // in non-real-time mode, a step needs a new submission
+    ASSERT_FALSE(backend.step());
+
+    // falls back to the other client when the action is withdrawn
+    high->withdraw();
+    action.values[0] = 12;
+    low->submit(action);
+    ASSERT_TRUE(backend.step());
+    ASSERT_EQ(12, frontend.get_desired_action(2).values[0]);
+
+    // the merge function gets the candidates sorted by priority
+    data->action_arbiter->set_merge_function(
+        [](const std::vector<ActionArbiter<Action>::Candidate> &candidates) {
+            Action merged = candidates[0].action;
+            merged.values[1] = candidates.size() > 1
+                                   ? candidates[1].action.values[0]
+                                   : -1;
+            return merged;
+        });
+    action.values[0] = 30;
+    high->submit(action);
+    ASSERT_TRUE(backend.step());
+    Action desired_action = frontend.get_desired_action(3);
+    ASSERT_EQ(30, desired_action.values[0]);
+    ASSERT_EQ(12, desired_action.values[1]);
+
+    // expired actions are ignored
+    action.values[0] = 40;
+    high->submit(action, -1.0);
+    ASSERT_FALSE(backend.step());
+    action.values[0] = 13;
+    low->submit(action);
+    ASSERT_TRUE(backend.step());
+    desired_action = frontend.get_desired_action(4);
+    ASSERT_EQ(13, desired_action.values[0]);
+    ASSERT_EQ(-1, desired_action.values[1]);
+}
+
+// Test if the slot of a client of a terminated process is reused
+TEST_F(TestRobotBackend, action_client_of_terminated_process)
+{
+    const std::string shared_memory_id = "test_robot_backend_arbiter";
+    auto arbiter = std::make_shared<ActionArbiter<Action>>(shared_memory_id, 1);
+
+    // a child process registers a client and terminates without unregistering
+    const pid_t child = fork();
+    if (child == 0)
+    {
+        auto child_arbiter =
+            std::make_shared<ActionArbiter<Action>>(shared_memory_id);
+        ActionClient<Action> client(child_arbiter, nullptr, 0);
+        client.submit(Action(), 1000.0);
+        // terminate without running destructors, like a crash
+        _exit(0);
+    }
+    ASSERT_GT(child, 0);
+    int child_status;
+    waitpid(child, &child_status, 0);
+    ASSERT_TRUE(WIFEXITED(child_status));
+
+    // the action of the terminated client is still valid
+    Action action;
+    ASSERT_TRUE(arbiter->select(action, false));
+
+    // the slot is reused and the old action is removed
+    {
+        ActionClient<Action> client(arbiter, nullptr, 1);
+        ASSERT_EQ(1, client.get_priority());
+        ASSERT_FALSE(arbiter->select(action, false));
+    }
+
+    // unregistering frees the slot again
+    {
+        ActionClient<Action> client(arbiter, nullptr, 2);
+        ASSERT_EQ(2, client.get_priority());
+    }
+
+    ActionArbiter<Action>::clear_memory(shared_memory_id);
+}
+
+// Test the visitor accessors
+TEST_F(TestRobotBackend, visitor_accessors)
+{
+    constexpr bool real_time_mode = false;
+
+    Backend backend(driver, data, real_time_mode);
+    backend.initialize();
+    Frontend frontend(data);
+
+    Action action;
+    action.values[0] = 42;
+    action.values[1] = 2000;  // above the maximum, so it is clipped
+    TimeIndex t = frontend.step(action).timeindex;
+
+    ASSERT_EQ(2000, frontend.with_desired_action(t, [](const Action &a) {
+        return a.values[1];
+    }));
+    ASSERT_EQ(1000, frontend.with_applied_action(t, [](const Action &a) {
+        return a.values[1];
+    }));
+    ASSERT_EQ(42, frontend.with_observation(t + 1, [](const Observation &o) {
+        return o.values[0];
+    }));
+    ASSERT_FALSE(
+        frontend.with_status(t, [](const Status &s) { return s.has_error(); }));
+
+    // visitors without return value
+    int value = 0;
+    frontend.with_observation(
+        t + 1, [&](const Observation &o) { value = o.values[1]; });
+    ASSERT_EQ(1000, value);
+}
+
+// Test if subscribed callbacks get all observations in the correct order
+TEST_F(TestRobotBackend, subscribe_observations)
+{
+    constexpr bool real_time_mode = false;
+    constexpr size_t num_actions = 10;
+
+    Backend backend(driver, data, real_time_mode);
+    backend.initialize();
+    Frontend frontend(data);
+
+    std::mutex mutex;
+    std::vector<std::pair<TimeIndex, Observation>> received;
+    auto subscription_id = frontend.subscribe_observations(
+        [&](const TimeIndex &first_timeindex,
+            const std::vector<Observation> &observations) {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (size_t i = 0; i < observations.size(); i++)
+            {
+                received.push_back(
+                    std::make_pair(first_timeindex + i, observations[i]));
+            }
+        });
+
+    Action action;
+    for (size_t i = 0; i < num_actions; i++)
+    {
+        action.values[0] = i;
+        frontend.step(action);
+    }
+
+    // callbacks run asynchronously, so give them some time
+    for (int i = 0; i < 1000; i++)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (received.size() >= num_actions)
+            {
+                break;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    frontend.unsubscribe_observations(subscription_id);
+
+    // observation t shows the result of action t - 1 (except for t = 0)
+    ASSERT_GE(received.size(), num_actions);
+    for (size_t i = 0; i < received.size(); i++)
+    {
+        ASSERT_EQ(static_cast<TimeIndex>(i), received[i].first);
+    }
+    for (size_t i = 1; i < num_actions; i++)
+    {
+        ASSERT_EQ(static_cast<int>(i - 1), received[i].second.values[0]);
+    }
+}
+
+// Test if a throwing callback does not affect the dispatcher and the others
+TEST_F(TestRobotBackend, failing_observation_callback)
+{
+    constexpr bool real_time_mode = false;
+    constexpr size_t num_actions = 5;
+
+    Backend backend(driver, data, real_time_mode);
+    backend.initialize();
+    Frontend frontend(data);
+    ObservationDispatcher<Observation> dispatcher(data->observation,
+                                                  data->control_block);
+
+    std::atomic<size_t> num_received(0);
+    dispatcher.subscribe(
+        [](const TimeIndex &, const std::vector<Observation> &) {
+            throw std::runtime_error("callback failed");
+        });
+    dispatcher.subscribe(
+        [&](const TimeIndex &, const std::vector<Observation> &observations) {
+            num_received += observations.size();
+        });
+
+    Action action;
+    for (size_t i = 0; i < num_actions; i++)
+    {
+        frontend.step(action);
+    }
+
+    // callbacks run asynchronously, so give them some time
+    for (int i = 0; i < 1000 && num_received < num_actions; i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    ASSERT_GE(num_received.load(), num_actions);
+    ASSERT_GE(dispatcher.get_number_of_failed_callbacks(), 1u);
+}
+
+// Test waiting for observations on the event file descriptor
+TEST_F(TestRobotBackend, observation_event_fd)
+{
+    constexpr bool real_time_mode = false;
+
+    Backend backend(driver, data, real_time_mode);
+    backend.initialize();
+    Frontend frontend(data);
+
+    pollfd poll_fd;
+    poll_fd.fd = frontend.get_observation_event_fd();
+    poll_fd.events = POLLIN;
+    ASSERT_GE(poll_fd.fd, 0);
+    ASSERT_EQ(poll_fd.fd, frontend.get_observation_event_fd());
+
+    // no observation before the first action
+    ASSERT_EQ(0, poll(&poll_fd, 1, 10));
+
+    Action action;
+    TimeIndex t = frontend.append_desired_action(action);
+    frontend.wait_until_timeindex(t + 1);
+
+    // observations 0 and 1 exist now but may be dispatched separately
+    uint64_t total_count = 0;
+    while (total_count < 2)
+    {
+        ASSERT_EQ(1, poll(&poll_fd, 1, 10000));
+        ASSERT_TRUE(poll_fd.revents & POLLIN);
+
+        uint64_t count = 0;
+        ASSERT_EQ(static_cast<ssize_t>(sizeof(count)),
+                  read(poll_fd.fd, &count, sizeof(count)));
+        total_count += count;
+    }
+    ASSERT_EQ(2u, total_count);
+
+    // reading resets the counter, so the fd is not readable anymore
+    ASSERT_EQ(0, poll(&poll_fd, 1, 10));
+}
+
+// Test if an observer sees the same data as the frontend
+TEST_F(TestRobotBackend, observer_frontend)
+{
+    typedef robot_interfaces::MultiProcessRobotData<Action, Observation>
+        MultiProcessData;
+
+    const std::string shared_memory_id = "test_robot_backend_observer";
+    constexpr bool real_time_mode = false;
+    constexpr size_t history_length = 5;
+
+    auto master_data = std::make_shared<MultiProcessData>(
+        shared_memory_id, true, history_length);
+    ObserverFrontend<Observation> observer(shared_memory_id);
+    ASSERT_EQ(time_series::EMPTY, observer.get_current_timeindex());
+    ASSERT_THROW(observer.get_latest_observation(), std::runtime_error);
+
+    Backend backend(driver, master_data, real_time_mode);
+    backend.initialize();
+    Frontend frontend(master_data);
+
+    Action action;
+    for (int i = 0; i < 10; i++)
+    {
+        action.values[0] = i;
+        action.values[1] = 2 * i;
+        frontend.step(action);
+    }
+    ASSERT_TRUE(observer.wait_until_timeindex(10, 1.0));
+
+    for (TimeIndex t = 10 - history_length + 1; t <= 10; t++)
+    {
+        Observation observation = observer.get_observation(t);
+        ASSERT_EQ(frontend.get_observation(t).values[0],
+                  observation.values[0]);
+        ASSERT_EQ(frontend.get_observation(t).values[1],
+                  observation.values[1]);
+    }
+    ASSERT_EQ(9, observer.get_latest_observation().values[0]);
+    ASSERT_FALSE(observer.get_latest_status().has_error());
+
+    // older observations are overwritten, newer ones do not exist yet
+    ASSERT_THROW(observer.get_observation(10 - history_length),
+                 std::invalid_argument);
+    ASSERT_THROW(observer.get_observation(11), std::invalid_argument);
+}
+
+// Test if invalid message headers are rejected before the payload is read
+TEST(TestSocketTransport, reject_invalid_messages)
+{
+    typedef robot_interfaces::internal::MessageHeader MessageHeader;
+    typedef robot_interfaces::internal::MessageType MessageType;
+
+    MessageHeader valid_header;
+    valid_header.magic = MessageHeader::MAGIC;
+    valid_header.type = static_cast<uint32_t>(MessageType::OBSERVATION);
+    valid_header.sequence = 0;
+    valid_header.send_time_ns = 0;
+    valid_header.num_elements = 0;
+    valid_header.payload_size = 0;
+
+    MessageHeader unknown_type = valid_header;
+    unknown_type.type = static_cast<uint32_t>(MessageType::STATUS) + 1;
+    MessageHeader too_large = valid_header;
+    too_large.payload_size = MessageHeader::MAX_PAYLOAD_SIZE + 1;
+    MessageHeader too_many_elements = valid_header;
+    too_many_elements.num_elements = 1000000;
+    too_many_elements.payload_size = 8;
+
+    for (const MessageHeader &header :
+         {unknown_type, too_large, too_many_elements})
+    {
+        int sockets[2];
+        ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sockets));
+        robot_interfaces::internal::SocketConnection connection(sockets[0]);
+
+        ASSERT_EQ(static_cast<ssize_t>(sizeof(header)),
+                  write(sockets[1], &header, sizeof(header)));
+        robot_interfaces::internal::Message message;
+        ASSERT_THROW(connection.receive(message), std::runtime_error);
+        close(sockets[1]);
+    }
+}
+
+// Test if a frontend on remote robot data controls the robot via the bridge
+TEST_F(TestRobotBackend, remote_robot_data)
+{
+    typedef robot_interfaces::RemoteRobotData<Action, Observation> RemoteData;
+    typedef robot_interfaces::RemoteRobotBridge<Action, Observation> Bridge;
+
+    constexpr bool real_time_mode = false;
+    constexpr uint16_t any_port = 0;
+    constexpr bool loopback_only = true;
+    constexpr int num_actions = 10;
+
+    Backend backend(driver, data, real_time_mode);
+    backend.initialize();
+    Bridge bridge(data, any_port, loopback_only);
+
+    auto remote_data =
+        std::make_shared<RemoteData>("localhost", bridge.get_port());
+    ASSERT_TRUE(remote_data->is_connected());
+    Frontend frontend(remote_data);
+
+    Action action;
+    for (int i = 0; i < num_actions; i++)
+    {
+        action.values[0] = i;
+        action.values[1] = 2 * i;
+        TimeIndex t = frontend.append_desired_action(action);
+        ASSERT_EQ(i, t);
+
+        frontend.wait_until_timeindex(t + 1);
+        ASSERT_EQ(i, frontend.get_observation(t + 1).values[0]);
+        ASSERT_EQ(2 * i, frontend.get_applied_action(t).values[1]);
+        ASSERT_FALSE(frontend.get_status(t).has_error());
+    }
+    ASSERT_EQ(2 * (num_actions - 1),
+              (*data->desired_action)[num_actions - 1].values[1]);
+
+    // all actions are received by the bridge and acknowledged
+    TransportStatistics statistics = remote_data->get_transport_statistics();
+    ASSERT_EQ(static_cast<uint64_t>(num_actions), statistics.elements_sent);
+    ASSERT_EQ(0u, statistics.messages_unacknowledged);
+    ASSERT_EQ(0u, statistics.messages_lost);
+    ASSERT_GT(statistics.last_latency_s, 0.0);
+    ASSERT_LE(statistics.mean_latency_s, statistics.max_latency_s);
+    // observations (one more than actions), applied actions and status
+    ASSERT_GE(statistics.elements_received,
+              static_cast<uint64_t>(3 * num_actions + 1));
+
+    TransportStatistics bridge_statistics = bridge.get_transport_statistics();
+    ASSERT_EQ(static_cast<uint64_t>(num_actions),
+              bridge_statistics.elements_received);
+    ASSERT_EQ(0u, bridge_statistics.messages_lost);
+    ASSERT_TRUE(bridge.is_connected());
+}
+
+// Test appending actions to a full buffer with and without timeout
+TEST_F(TestRobotBackend, append_to_full_buffer)
+{
+    constexpr bool real_time_mode = false;
+    constexpr size_t history_length = 5;
+
+    auto small_data = std::make_shared<Data>(history_length);
+
+    // the backend is not stepped, so no action is applied
+    Backend backend(driver,
+                    small_data,
+                    real_time_mode,
+                    std::numeric_limits<double>::infinity(),
+                    0,
+                    false);
+    Frontend frontend(small_data);
+
+    Action action;
+    for (size_t i = 0; i < history_length; i++)
+    {
+        Frontend::AppendResult result =
+            frontend.try_append_desired_action(action);
+        ASSERT_TRUE(result.appended);
+        ASSERT_EQ(static_cast<TimeIndex>(i), result.timeindex);
+        ASSERT_EQ(static_cast<TimeIndex>(i + 1), result.queued);
+    }
+    ASSERT_EQ(0u, frontend.get_number_of_blocked_appends());
+
+    Frontend::AppendResult result = frontend.try_append_desired_action(action);
+    ASSERT_FALSE(result.appended);
+    ASSERT_EQ(static_cast<TimeIndex>(history_length), result.queued);
+
+    result = frontend.append_desired_action(action, 0.01);
+    ASSERT_FALSE(result.appended);
+    ASSERT_EQ(2u, frontend.get_number_of_blocked_appends());
+
+    // after the backend applied the oldest action, there is space again
+    ASSERT_TRUE(backend.step());
+    ASSERT_TRUE(backend.step());
+    result = frontend.try_append_desired_action(action);
+    ASSERT_TRUE(result.appended);
+    ASSERT_EQ(static_cast<TimeIndex>(history_length), result.timeindex);
+    ASSERT_EQ(static_cast<TimeIndex>(history_length - 1), result.queued);
+}
+
+// Test if step timing and overruns are reported in the status
+TEST_F(TestRobotBackend, step_timing)
+{
+    constexpr bool real_time_mode = false;
+
+    Backend backend(driver, data, real_time_mode);
+    // the example driver needs about 2 ms to apply an action, so every step
+    // is an overrun
+    backend.set_max_step_duration(0.001);
+    backend.initialize();
+    Frontend frontend(data);
+
+    Action action;
+    action.values[0] = 42;
+    action.values[1] = 42;
+
+    robot_interfaces::TimeIndex t = 0;
+    for (int i = 0; i < 5; i++)
+    {
+        t = frontend.append_desired_action(action);
+    }
+    Status status = frontend.get_status(t + 1);
+
+    // the status contains the timing of the previous step
+    ASSERT_TRUE(status.timing.overrun);
+    ASSERT_EQ(t + 1, status.timing.overrun_count);
+    ASSERT_GE(status.timing.apply_action_duration_s, 0.002);
+    ASSERT_GE(status.timing.step_duration_s,
+              status.timing.apply_action_duration_s);
+    ASSERT_GE(status.timing.max_step_duration_s,
+              status.timing.step_duration_s);
+
+    // no timing for the first step
+    ASSERT_EQ(0u, frontend.get_status(0).timing.overrun_count);
+}
+
+// Test driving the backend with step() instead of running it in a thread
+TEST_F(TestRobotBackend, step_without_thread)
+{
+    constexpr bool real_time_mode = false;
+    constexpr double first_action_timeout =
+        std::numeric_limits<double>::infinity();
+    constexpr uint32_t max_number_of_actions = 3;
+    constexpr bool run_in_thread = false;
+
+    Backend backend(driver,
+                    data,
+                    real_time_mode,
+                    first_action_timeout,
+                    max_number_of_actions,
+                    run_in_thread);
+    backend.initialize();
+    Frontend frontend(data);
+
+    // nothing happens before the first action is provided
+    ASSERT_FALSE(backend.step());
+    ASSERT_EQ(0, data->observation->length());
+
+    Action action;
+    for (int i = 0; i < 3; i++)
+    {
+        action.values[0] = 100 * i;
+        action.values[1] = 100 * i + 1;
+        ASSERT_EQ(i, frontend.append_desired_action(action));
+        ASSERT_TRUE(backend.step());
+        ASSERT_EQ(100 * i, frontend.get_applied_action(i).values[0]);
+
+        // next action is not provided yet, observation of the next step is
+        // recorded only once
+        ASSERT_FALSE(backend.step());
+        ASSERT_FALSE(backend.step());
+        ASSERT_EQ(i + 2, data->observation->length());
+        ASSERT_EQ(i + 1, frontend.get_current_timeindex());
+    }
+
+    // the step after the maximum number of actions ends with an error
+    ASSERT_FALSE(backend.is_running());
+    ASSERT_EQ(Status::ErrorStatus::BACKEND_ERROR,
+              frontend.get_status(3).error_status);
+    ASSERT_FALSE(backend.step());
+    backend.wait_until_terminated();
 }
@@ -0,0 +1,389 @@
+/**
+ * @file
+ * @brief Tests for the binary log files of the RobotLogger and their reader.
+ * @copyright Copyright (c) 2020, Max Planck Gesellschaft.
+ */
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <robot_interfaces/n_finger_observation.hpp>
+#include <robot_interfaces/n_joint_action.hpp>
+#include <robot_interfaces/n_joint_observation.hpp>
+#include <robot_interfaces/robot_backend.hpp>
+#include <robot_interfaces/robot_data.hpp>
+#include <robot_interfaces/robot_driver.hpp>
+#include <robot_interfaces/robot_frontend.hpp>
+#include <robot_interfaces/robot_log_file.hpp>
+#include <robot_interfaces/robot_log_reader.hpp>
+#include <robot_interfaces/robot_logger.hpp>
+#include <robot_interfaces/status.hpp>
+
+using namespace robot_interfaces;
+
+//! Check if write_data() writes the same values as get_data() returns.
+void expect_write_data_matches_get_data(Loggable &loggable)
+{
+    std::vector<double> expected;
+    for (const std::vector<double> &field : loggable.get_data())
+    {
+        expected.insert(expected.end(), field.begin(), field.end());
+    }
+    ASSERT_EQ(expected.size(), loggable.get_number_of_values());
+
+    std::vector<double> values(expected.size());
+    ASSERT_EQ(expected.size(),
+              loggable.write_data(values.data(), values.size()));
+    ASSERT_EQ(expected, values);
+
+    // too small buffer
+    ASSERT_THROW(loggable.write_data(values.data(), values.size() - 1),
+                 std::length_error);
+}
+
+//! Driver whose observed torque is the torque of the last applied action.
+class TorqueDriver : public RobotDriver<NJointAction<2>, NJointObservation<2>>
+{
+public:
+    void initialize() override
+    {
+    }
+
+    Action apply_action(const Action &desired_action) override
+    {
+        observation_.torque = desired_action.torque;
+        return desired_action;
+    }
+
+    Observation get_latest_observation() override
+    {
+        return observation_;
+    }
+
+    std::string get_error() override
+    {
+        return "";
+    }
+
+    void shutdown() override
+    {
+    }
+
+private:
+    Observation observation_;
+};
+
+//! Test fixture to create and delete a temporary log file
+class TestRobotLogger : public ::testing::Test
+{
+protected:
+    std::string log_file;
+
+    void SetUp() override
+    {
+        char filename[] = "/tmp/test_robot_logger_XXXXXX";
+        const int fd = mkstemp(filename);
+        ASSERT_NE(-1, fd);
+        close(fd);
+        log_file = filename;
+    }
+
+    void TearDown() override
+    {
+        // clean up
+        std::remove(log_file.c_str());
+    }
+
+    //! Read the data of the log file as doubles and check the header.
+    std::vector<double> read_data(const RobotLogLayout layout,
+                                  const uint32_t chunk_size,
+                                  const std::vector<std::string> &names)
+    {
+        std::ifstream file(log_file, std::ios::binary);
+        std::vector<char> content((std::istreambuf_iterator<char>(file)),
+                                  std::istreambuf_iterator<char>());
+
+        RobotLogFileHeader header;
+        std::memcpy(&header, content.data(), sizeof(header));
+        EXPECT_STREQ(RobotLogFileHeader::get_magic(), header.magic);
+        EXPECT_EQ(static_cast<uint32_t>(layout), header.layout);
+        EXPECT_EQ(names.size(), header.num_columns);
+        EXPECT_EQ(chunk_size, header.chunk_size);
+        EXPECT_EQ(0u, header.header_size % sizeof(double));
+
+        const char *data = content.data() + sizeof(header);
+        for (const std::string &name : names)
+        {
+            uint32_t length;
+            std::memcpy(&length, data, sizeof(length));
+            data += sizeof(length);
+            EXPECT_EQ(name, std::string(data, length));
+            data += length;
+        }
+
+        std::vector<double> values((content.size() - header.header_size) /
+                                   sizeof(double));
+        std::memcpy(values.data(),
+                    content.data() + header.header_size,
+                    values.size() * sizeof(double));
+        return values;
+    }
+};
+
+// Test if records are written one after the other
+TEST_F(TestRobotLogger, binary_records)
+{
+    const std::vector<std::string> names = {"time_index", "a", "b"};
+    {
+        RobotBinaryLogWriter writer(log_file, names, RobotLogLayout::RECORDS);
+        for (int i = 0; i < 3; i++)
+        {
+            writer.append_record({double(i), 10.0 * i, 0.5 * i});
+        }
+        ASSERT_THROW(writer.append_record({1.0}), std::invalid_argument);
+    }
+
+    std::vector<double> values = read_data(RobotLogLayout::RECORDS, 1, names);
+    std::vector<double> expected = {0, 0, 0, 1, 10, 0.5, 2, 20, 1};
+    ASSERT_EQ(expected, values);
+}
+
+// Test if records are written in chunks, column by column
+TEST_F(TestRobotLogger, binary_column_chunks)
+{
+    const std::vector<std::string> names = {"time_index", "value"};
+    constexpr uint32_t chunk_size = 2;
+    {
+        RobotBinaryLogWriter writer(
+            log_file, names, RobotLogLayout::COLUMN_CHUNKS, chunk_size);
+        for (int i = 0; i < 5; i++)
+        {
+            writer.append_record({double(i), 10.0 * i});
+        }
+    }
+
+    // the last chunk is incomplete
+    std::vector<double> values =
+        read_data(RobotLogLayout::COLUMN_CHUNKS, chunk_size, names);
+    std::vector<double> expected = {0, 1, 0, 10, 2, 3, 20, 30, 4, 40};
+    ASSERT_EQ(expected, values);
+}
+
+// Test random access to the records with the reader, for both layouts
+TEST_F(TestRobotLogger, reader)
+{
+    const std::vector<std::string> names = {"time_index", "timestamp", "a"};
+    // time indices 0, 1, 2, 3, 5, 6, 7, i.e. with a gap
+    const std::vector<int> time_indices = {0, 1, 2, 3, 5, 6, 7};
+
+    for (RobotLogLayout layout :
+         {RobotLogLayout::RECORDS, RobotLogLayout::COLUMN_CHUNKS})
+    {
+        {
+            RobotBinaryLogWriter writer(log_file, names, layout, 3);
+            for (int t : time_indices)
+            {
+                writer.append_record({double(t), 0.1 * t, 10.0 * t});
+            }
+        }
+
+        RobotLogReader reader(log_file);
+        ASSERT_EQ(layout, reader.get_layout());
+        ASSERT_EQ(names, reader.get_column_names());
+        ASSERT_EQ(time_indices.size(), reader.get_number_of_records());
+        ASSERT_EQ(2u, reader.get_column_index("a"));
+        ASSERT_THROW(reader.get_column_index("b"), std::invalid_argument);
+
+        ASSERT_EQ(50.0, reader.get_value(4, 2));
+        ASSERT_EQ(std::vector<double>({6, 0.1 * 6, 60}), reader.get_record(5));
+        ASSERT_THROW(reader.get_value(7, 0), std::out_of_range);
+        ASSERT_THROW(reader.get_value(0, 3), std::out_of_range);
+
+        std::vector<double> column;
+        for (const RobotLogColumnView &view : reader.get_column_views(2))
+        {
+            for (size_t i = 0; i < view.size; i++)
+            {
+                column.push_back(view[i]);
+            }
+        }
+        ASSERT_EQ(std::vector<double>({0, 10, 20, 30, 50, 60, 70}), column);
+
+        ASSERT_EQ(3u, reader.find_record(3));
+        ASSERT_EQ(4u, reader.find_record(5));
+        ASSERT_EQ(6u, reader.find_record(7));
+        ASSERT_THROW(reader.find_record(4), std::out_of_range);
+        ASSERT_THROW(reader.find_record(8), std::out_of_range);
+
+        ASSERT_EQ(0u, reader.find_record_by_timestamp(-1));
+        ASSERT_EQ(4u, reader.find_record_by_timestamp(0.45));
+        ASSERT_EQ(7u, reader.find_record_by_timestamp(1.0));
+    }
+
+    // text logs cannot be read
+    {
+        std::ofstream file(log_file);
+        file << "#time_index timestamp a" << std::endl;
+    }
+    ASSERT_THROW(RobotLogReader reader(log_file), std::runtime_error);
+}
+
+// Test if the logger writes readable binary logs of a running backend
+TEST_F(TestRobotLogger, logger_binary_formats)
+{
+    typedef NJointAction<2> Action;
+    typedef NJointObservation<2> Observation;
+    typedef RobotData<Action, Observation> Data;
+
+    constexpr bool real_time_mode = false;
+    constexpr int block_size = 3;
+    constexpr int num_actions = 10;
+
+    for (RobotLogFormat format :
+         {RobotLogFormat::BINARY, RobotLogFormat::BINARY_COLUMN_CHUNKS})
+    {
+        std::shared_ptr<Data> data =
+            std::make_shared<SingleProcessRobotData<Action, Observation>>();
+        RobotBackend<Action, Observation> backend(
+            std::make_shared<TorqueDriver>(), data, real_time_mode);
+        backend.initialize();
+        RobotFrontend<Action, Observation> frontend(data);
+
+        RobotLogger<Action, Observation> logger(data, block_size);
+        logger.start(log_file, format);
+
+        TimeIndex t = 0;
+        for (int i = 0; i < num_actions; i++)
+        {
+            t = frontend.append_desired_action(
+                Action::Torque(Action::Vector(i, 2 * i)));
+            frontend.wait_until_timeindex(t + 1);
+
+            // The logger starts at the newest time index when it notices the
+            // first action (it checks every 0.1 s).  The backend does not
+            // proceed without the next action, so this is time index 1.
+            if (i == 0)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(300));
+            }
+        }
+        // writes the remaining time indices and closes the file
+        logger.stop();
+
+        RobotLogReader reader(log_file);
+        ASSERT_EQ(format == RobotLogFormat::BINARY
+                      ? RobotLogLayout::RECORDS
+                      : RobotLogLayout::COLUMN_CHUNKS,
+                  reader.get_layout());
+        ASSERT_EQ(logger.get_header().size(), reader.get_number_of_columns());
+        ASSERT_EQ("time_index", reader.get_column_names()[0]);
+
+        ASSERT_EQ(static_cast<size_t>(num_actions - 1),
+                  reader.get_number_of_records());
+        const size_t last_record = reader.get_number_of_records() - 1;
+        ASSERT_EQ(last_record, reader.find_record(t));
+
+        const size_t applied_torque =
+            reader.get_column_index("applied_action_torque_1");
+        const size_t observed_torque =
+            reader.get_column_index("observation_torque_1");
+        for (size_t record = 0; record <= last_record; record++)
+        {
+            const double j = reader.get_value(record, 0);
+            ASSERT_EQ(record + 1, j);
+            ASSERT_EQ(2 * j, reader.get_value(record, applied_torque));
+            // the observation is recorded before the action is applied
+            ASSERT_EQ(2 * (j - 1), reader.get_value(record, observed_torque));
+        }
+    }
+}
+
+// Test if a logger that is never started can be destroyed
+TEST_F(TestRobotLogger, logger_not_started)
+{
+    typedef NJointAction<2> Action;
+    typedef NJointObservation<2> Observation;
+
+    auto data = std::make_shared<SingleProcessRobotData<Action, Observation>>();
+    for (int i = 0; i < 5; i++)
+    {
+        data->desired_action->append(Action());
+        data->applied_action->append(Action());
+        data->observation->append(Observation());
+        data->status->append(Status());
+    }
+
+    {
+        RobotLogger<Action, Observation> logger(data, 2);
+        logger.stop();
+    }
+    {
+        // stopped only by the destructor
+        RobotLogger<Action, Observation> logger(data, 2);
+    }
+}
+
+// Test the values of the loggable types
+TEST(TestLoggable, write_data)
+{
+    NJointAction<2> action(NJointAction<2>::Vector(1, 2),
+                           NJointAction<2>::Vector(3, 4),
+                           NJointAction<2>::Vector(5, 6),
+                           NJointAction<2>::Vector(7, 8));
+    expect_write_data_matches_get_data(action);
+    std::vector<std::vector<double>> expected_action_data = {
+        {1, 2}, {3, 4}, {5, 6}, {7, 8}};
+    ASSERT_EQ(expected_action_data, action.get_data());
+
+    NJointObservation<2> observation;
+    observation.position << 1, 2;
+    observation.velocity << 3, 4;
+    observation.torque << 5, 6;
+    expect_write_data_matches_get_data(observation);
+
+    Status status;
+    status.action_repetitions = 3;
+    status.set_error(Status::ErrorStatus::DRIVER_ERROR, "foo");
+    status.timing.step_duration_s = 0.5;
+    expect_write_data_matches_get_data(status);
+    std::vector<std::vector<double>> expected_status_data = {
+        {3}, {1}, {0}, {0}, {0.5}, {0}, {0}, {0}};
+    ASSERT_EQ(expected_status_data, status.get_data());
+
+    NFingerObservation<1> finger_observation;
+    finger_observation.position << 1, 2, 3;
+    finger_observation.tip_force << 4;
+    expect_write_data_matches_get_data(finger_observation);
+    std::vector<std::vector<double>> expected_finger_data = {
+        {1, 2, 3}, {0, 0, 0}, {0, 0, 0}, {4}};
+    ASSERT_EQ(expected_finger_data, finger_observation.get_data());
+}
+
+// Test if the names of the fields are taken from serialize()
+TEST(TestLoggable, get_name)
+{
+    std::vector<std::string> expected_action_names = {
+        "torque", "position", "position_kp", "position_kd"};
+    ASSERT_EQ(expected_action_names, NJointAction<2>().get_name());
+
+    // error_message is skipped as it is not numeric and the fields of timing
+    // are prefixed with its name
+    std::vector<std::string> expected_status_names = {
+        "action_repetitions",
+        "error_status",
+        "timing_overrun",
+        "timing_overrun_count",
+        "timing_step_duration_s",
+        "timing_max_step_duration_s",
+        "timing_get_observation_duration_s",
+        "timing_apply_action_duration_s"};
+    ASSERT_EQ(expected_status_names, Status().get_name());
+}
@@ -5,6 +5,11 @@
  */
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include <robot_interfaces/sensors/sensor_backend.hpp>
 #include <robot_interfaces/sensors/sensor_data.hpp>
 #include <robot_interfaces/sensors/sensor_frontend.hpp>
@@ -28,3 +33,67 @@ TEST(TestSensorInterface, basic_pipeline)
         ASSERT_EQ(obs, t);
     }
 }
+
+// test waiting for observations with timeout
+TEST(TestSensorInterface, wait_with_timeout)
+{
+    auto data = std::make_shared<SingleProcessSensorData<int>>();
+    auto frontend = SensorFrontend<int>(data);
+
+    // no backend yet, so there are no observations
+    ASSERT_FALSE(frontend.try_wait_until_timeindex(0));
+    ASSERT_FALSE(frontend.wait_until_timeindex(0, 0.01));
+    ASSERT_EQ(time_series::EMPTY,
+              frontend.wait_for_any_newer_than(time_series::EMPTY, 0.01));
+
+    auto driver =
+        std::make_shared<robot_interfaces::testing::DummySensorDriver>();
+    auto backend = SensorBackend<int>(driver, data);
+
+    ASSERT_TRUE(frontend.wait_until_timeindex(5, 10.0));
+    ASSERT_TRUE(frontend.try_wait_until_timeindex(5));
+    ASSERT_GT(frontend.wait_for_any_newer_than(5), 5);
+}
+
+// test if subscribed callbacks get all observations in the correct order
+TEST(TestSensorInterface, subscribe_observations)
+{
+    auto data = std::make_shared<SingleProcessSensorData<int>>();
+    auto frontend = SensorFrontend<int>(data);
+
+    std::mutex mutex;
+    std::vector<int> received;
+    auto subscription_id = frontend.subscribe_observations(
+        [&](const time_series::Index &first_timeindex,
+            const std::vector<int> &observations) {
+            std::lock_guard<std::mutex> lock(mutex);
+            ASSERT_EQ(static_cast<time_series::Index>(received.size()),
+                      first_timeindex);
+            received.insert(
+                received.end(), observations.begin(), observations.end());
+        });
+
+    auto driver =
+        std::make_shared<robot_interfaces::testing::DummySensorDriver>();
+    auto backend = SensorBackend<int>(driver, data);
+
+    for (int i = 0; i < 1000; i++)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (received.size() >= 20u)
+            {
+                break;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    frontend.unsubscribe_observations(subscription_id);
+
+    ASSERT_GE(received.size(), 20u);
+    for (size_t i = 0; i < received.size(); i++)
+    {
+        ASSERT_EQ(static_cast<int>(i), received[i]);
+    }
+}